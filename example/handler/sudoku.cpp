@@ -2,6 +2,8 @@
 
 #include "log/log.h"
 #include "task_coroutine/task_coroutine.h"
+#include "task_coroutine/task_future.h"
+#include "task_coroutine/task_scope.h"
 #include "http/http_context.h"
 
 void Sudoku::handler(context::Context& ctx, model::SudokuReq& req,
@@ -15,10 +17,18 @@ void Sudoku::handler(context::Context& ctx, model::SudokuReq& req,
     rsp.sudokus[i].sudoku = std::move(req.sudokus[i]);
   }
 
-  std::vector<task_coroutine::Coroutine> cs;
-  for (size_t i = 0; i < req.sudokus.size(); ++i) {
-    cs.emplace_back(solve, &rsp.sudokus[i]);
+  // one coroutine per sudoku, created as a batch: the TaskMetas come from
+  // the pool together and each task_group is queued and woken only once.
+  // solving is pure computation, run it as BATCH so that the event loops and
+  // other requests' handlers are not queued behind it
+  std::vector<void*> args(rsp.sudokus.size());
+  for (size_t i = 0; i < rsp.sudokus.size(); ++i) {
+    args[i] = &rsp.sudokus[i];
   }
+  std::vector<task_coroutine::Coroutine> cs =
+      task_coroutine::Coroutine::spawn_n(
+          args.size(), solve, args.data(),
+          task_coroutine::TaskAttr(task_coroutine::TaskPriority::BATCH));
   for (auto& c : cs) {
     c.join();
   }
@@ -52,6 +62,60 @@ bool Sudoku::check_param(const std::vector<std::string>& sudoku) {
 }
 
 void Sudoku::solve_sudoku(std::vector<std::string>& sudoku) {
+  // fan out on the candidates of the first blank cell, the first child that
+  // finds a solution cancels its siblings and hands the grid back through
+  // the promise; the future stays empty when no candidate leads to one
+  size_t bi = 9, bj = 9;
+  for (size_t i = 0; i < 9 && bi == 9; ++i) {
+    for (size_t j = 0; j < 9; ++j) {
+      if (sudoku[i][j] == '.') {
+        bi = i;
+        bj = j;
+        break;
+      }
+    }
+  }
+  if (bi == 9) {
+    return;
+  }
+  auto candidate = [&sudoku, bi, bj](char n) -> bool {
+    for (size_t k = 0; k < 9; ++k) {
+      if (sudoku[bi][k] == n || sudoku[k][bj] == n ||
+          sudoku[bi / 3 * 3 + k / 3][bj / 3 * 3 + k % 3] == n) {
+        return false;
+      }
+    }
+    return true;
+  };
+  task_coroutine::Promise<std::vector<std::string>> promise;
+  task_coroutine::Future<std::vector<std::string>> solution =
+      promise.get_future();
+  task_coroutine::TaskScope scope;
+  for (char n = '1'; n <= '9'; ++n) {
+    if (!candidate(n)) {
+      continue;
+    }
+    std::vector<std::string> s = sudoku;
+    s[bi][bj] = n;
+    auto child = [&scope, &promise, s = std::move(s)]() mutable {
+      if (search_sudoku(s) && scope.cancel()) {
+        promise.set_value(std::move(s));
+      }
+    };
+    // out of memory for a coroutine: search this candidate inline
+    if (!scope.spawn(child, task_coroutine::TaskAttr(
+                                task_coroutine::TaskPriority::BATCH)) &&
+        !scope.cancelled()) {
+      child();
+    }
+  }
+  scope.join();
+  if (solution.has_value()) {
+    sudoku = solution.get();
+  }
+}
+
+bool Sudoku::search_sudoku(std::vector<std::string>& sudoku) {
   size_t state[9] = {};
   std::vector<size_t> blank;
   for (size_t i = 0; i < 9; ++i) {
@@ -64,10 +128,20 @@ void Sudoku::solve_sudoku(std::vector<std::string>& sudoku) {
       }
     }
   }
+  // check for cancellation every 1024 nodes, stop once a sibling has the answer
+  size_t nodes = 0;
+  bool cancelled = false;
   auto f = [&](auto&& self, size_t id) -> bool {
     if (id == blank.size()) {
       return true;
     }
+    if ((++nodes & 1023) == 0 &&
+        task_coroutine::TaskScope::current_cancelled()) {
+      cancelled = true;
+    }
+    if (cancelled) {
+      return false;
+    }
     size_t i = blank[id] >> 8;
     size_t j = blank[id] & 0xff;
     size_t new_state =
@@ -83,5 +157,5 @@ void Sudoku::solve_sudoku(std::vector<std::string>& sudoku) {
     }
     return false;
   };
-  f(f, 0);
+  return f(f, 0);
 }
\ No newline at end of file
@@ -12,4 +12,6 @@ class Sudoku {
   static bool check_param(const std::vector<std::string>& sudoku);
 
   static void solve_sudoku(std::vector<std::string>& sodoku);
+
+  static bool search_sudoku(std::vector<std::string>& sudoku);
 };
\ No newline at end of file
@@ -1,12 +1,46 @@
 #include "http_server.h"
 
+#include <errno.h>
+#include <unistd.h>
+
 #include "http_request.h"
 #include "http_response.h"
 #include "log/log.h"
+#include "net/fd_watcher.h"
 #include "utils/defer.hpp"
 #include "utils/fmt.h"
 
 namespace http {
+
+// send_all writes all of data to the non-blocking connection fd. When the
+// socket buffer is full, the coroutine parks until the fd is writable (see
+// net::FdWatcher), the worker thread keeps running other coroutines.
+static void send_all(int fd, const std::string& data) {
+  static constexpr int SEND_TIMEOUT_MS = 3000;
+  const char* p = data.c_str();
+  size_t left = data.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd, p, left);
+    if (n >= 0) {
+      p += n;
+      left -= static_cast<size_t>(n);
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+        net::FdWatcher::wait(fd, EPOLLOUT, SEND_TIMEOUT_MS)) {
+      continue;
+    }
+    // errno is from write, or from FdWatcher::wait (ETIMEDOUT on timeout)
+    LOG_WARN("HttpServer",
+             utils::fmt::sprintf("send failed, fd = %d, left = %zu, errno = %d",
+                                 fd, left, errno));
+    return;
+  }
+}
+
 HttpServer::HttpServer(in_port_t port)
     : svr_(port, HttpServer::new_connection_handler, this), pool_(1024) {}
 
@@ -32,7 +66,7 @@ void HttpServer::new_connection_handler(net::Connection* conn, void* arg) {
       auto data = HttpResponse::response(
           nullptr, 500, "text/html; charset=utf-8", HttpResponse::Html500,
           strlen(HttpResponse::Html500));
-      write(conn->fd_operator().fd(), data.c_str(), data.size());
+      send_all(conn->fd_operator().fd(), data);
       conn->close();
     }
 
@@ -61,7 +95,7 @@ void HttpServer::new_connection_handler(net::Connection* conn, void* arg) {
       auto data = HttpResponse::response(ctx, 404, "text/html; charset=utf-8",
                                          HttpResponse::Html404,
                                          strlen(HttpResponse::Html404));
-      write(conn->fd_operator().fd(), data.c_str(), data.size());
+      send_all(conn->fd_operator().fd(), data);
       conn->close();
       return;
     }
@@ -73,13 +107,13 @@ void HttpServer::new_connection_handler(net::Connection* conn, void* arg) {
       auto data = HttpResponse::response(ctx, 400, "text/html; charset=utf-8",
                                          HttpResponse::Html400,
                                          strlen(HttpResponse::Html400));
-      write(conn->fd_operator().fd(), data.c_str(), data.size());
+      send_all(conn->fd_operator().fd(), data);
       conn->close();
       return;
     }
     auto data = HttpResponse::response(ctx, 200, "application/json",
                                        rsp.c_str(), rsp.size());
-    write(conn->fd_operator().fd(), data.c_str(), data.size());
+    send_all(conn->fd_operator().fd(), data);
   });
 }
 
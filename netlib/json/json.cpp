@@ -3,6 +3,8 @@
 #include <cassert>
 #include <cstring>
 
+#include "utils/task_hooks.h"
+
 namespace json {
 
 Json::Json(const Json& rhs) : type_(rhs.type_), data_(nullptr) {
@@ -387,7 +389,11 @@ Json Json::build_array(const char* raw, const char* end, const char*& next) {
   if (data == nullptr) {
     return build_error(ErrMsg[10]);
   }
+  // parsing a large array can take long: give the worker back to other
+  // coroutines when the watchdog asks for it
+  utils::YieldCounter yield_counter;
   for (;;) {
+    yield_counter.tick();
     data->emplace_back(build(p, end, p));
     if (data->back().type_ == Type::Error) {
       auto errmsg = data->back().data_;
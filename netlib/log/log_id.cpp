@@ -1,6 +1,7 @@
 #include "log_id.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 #include <cstdio>
 
@@ -10,12 +10,25 @@ void Connection::close() {
 
 void Connection::on_hup(void* arg) {
   Connection* conn = (Connection*)arg;
-  int expected = 0;
-  while (!conn->state_.compare_exchange_weak(expected, 1)) {
-    task_coroutine::Coroutine::yield();
-    expected = 0;
+  // runs as a stackless task: if the input handler is still running, wait
+  // for it in a coroutine instead of blocking the worker.
+  if (!conn->handler_mu_.try_lock()) {
+    auto wait_release = [conn]() {
+      conn->handler_mu_.lock();
+      release(conn);
+    };
+    if (task_coroutine::spawn(wait_release).valid()) {
+      return;
+    }
+    // out of memory for a coroutine: wait here, the lock blocks the worker
+    // as a blocking call until the handler returns
+    conn->handler_mu_.lock();
   }
-  conn->state_.store(0);
+  release(conn);
+}
+
+void Connection::release(Connection* conn) {
+  conn->handler_mu_.unlock();
   ::close(conn->fd_operator_.fd());
   NetPool::put<Connection>(conn);
 }
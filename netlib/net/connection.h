@@ -12,7 +12,7 @@ class Connection {
  public:
   using HandlerFunc = void (*)(Connection*);
 
-  Connection() : state_(0) {
+  Connection() {
     fd_operator_.set_handle_read(on_read, this);
     fd_operator_.set_handle_write(on_write, this);
     fd_operator_.set_handle_hup(on_hup, this);
@@ -57,20 +57,20 @@ class Connection {
       return;
     }
     if (conn->input_handler_ != nullptr) {
-      int expected = 0;
-      if (conn->state_.compare_exchange_strong(expected, 1)) {
-        task_coroutine::Coroutine c(on_handler, conn);
+      if (conn->handler_mu_.try_lock()) {
+        auto handle = [conn]() {
+          conn->input_handler_(conn);
+          conn->handler_mu_.unlock();
+        };
+        // out of memory for a coroutine: run the handler inline on the
+        // event loop, as the baseline Coroutine did
+        if (!task_coroutine::spawn(handle).valid()) {
+          handle();
+        }
       }
     }
   }
 
-  static void* on_handler(void* arg) {
-    Connection* conn = (Connection*)arg;
-    conn->input_handler_(conn);
-    conn->state_.store(0);
-    return nullptr;
-  }
-
   static void on_write(void* arg) {
     Connection* conn = (Connection*)arg;
     if (conn->output_handler_ != nullptr) {
@@ -82,6 +82,9 @@ class Connection {
 
   static void on_hup(void* arg);
 
+  // release closes the fd and returns conn to NetPool, handler_mu_ is held.
+  static void release(Connection* conn);
+
  private:
   FDOperator fd_operator_;
   Address address_;      // remote address.
@@ -92,6 +95,6 @@ class Connection {
 
   void* data_;  // user data.
 
-  std::atomic<int> state_;  // 0 idle, 1 inprocess
+  task_coroutine::CoMutex handler_mu_;  // held while input_handler_ runs
 };
 }  // namespace net
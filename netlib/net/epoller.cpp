@@ -89,9 +89,6 @@ void Epoller::control(FDOperator* oper, Event event) {
 
 void Epoller::handler(size_t n) {
   bool trigger_read, trigger_write, trigger_hup, trigger_error;
-  if (on_hups_ == nullptr) {
-    on_hups_ = new (std::nothrow) std::vector<FDOperator::HandlerFunc>;
-  }
   for (size_t i = 0; i < n; ++i) {
     FDOperator* op = static_cast<FDOperator*>(events_[i].data.ptr);
 
@@ -119,19 +116,19 @@ void Epoller::handler(size_t n) {
       op->handle_write();
     }
   }
-  if (on_hups_ != nullptr && on_hups_->size() > 0) {
-    task_coroutine::Coroutine c(handler_hups, on_hups_);
-    on_hups_ = nullptr;
-  }
-}
-
-void* Epoller::handler_hups(void* on_hups) {
-  auto list = (std::vector<FDOperator::HandlerFunc>*)on_hups;
-  for (auto& handler : *list) {
-    handler.f(handler.arg);
+  if (!on_hups_.empty()) {
+    // the hup handlers are short and rarely block, they are moved into a
+    // stackless task instead of a coroutine.
+    auto handle = [on_hups = std::move(on_hups_)]() {
+      for (auto& handler : on_hups) {
+        handler.f(handler.arg);
+      }
+    };
+    on_hups_.clear();
+    if (!task_coroutine::post(std::move(handle))) {
+      handle();  // out of memory, handle was not moved
+    }
   }
-  delete list;
-  return nullptr;
 }
 
 void Epoller::add_hup(FDOperator* op) {
@@ -142,11 +139,7 @@ void Epoller::add_hup(FDOperator* op) {
                             op->fd_, errno));
   }
   if (op->hup_.f != nullptr) {
-    if (on_hups_ != nullptr) {
-      on_hups_->emplace_back(op->hup_);
-    } else {
-      op->hup_.f(op->hup_.arg);
-    }
+    on_hups_.emplace_back(op->hup_);
   }
 }
 
@@ -33,17 +33,18 @@ class Epoller {
 
   void control(FDOperator* oper, Event event);
 
+  // the epoll fd is readable while events are pending, see Server::event_loop
+  int fd() const { return epfd_; }
+
  private:
   void handler(size_t n);
 
-  // run in task_coroutine
-  static void* handler_hups(void* on_hups);
-
   void add_hup(FDOperator* op);
 
   const int epfd_;  // epoll fd
   EventList events_;
-  std::vector<FDOperator::HandlerFunc>* on_hups_;
+  // run in a stackless task (task_coroutine::post), must not block
+  std::vector<FDOperator::HandlerFunc> on_hups_;
 };
 
 }  // namespace net
@@ -0,0 +1,109 @@
+#include "fd_watcher.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+#include "logger.h"
+
+namespace net {
+
+FdWatcher::FdWatcher() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {
+  assert(epfd_ >= 0);
+  // the watcher lives until the process exits
+  std::thread(&FdWatcher::run, this).detach();
+}
+
+FdWatcher& FdWatcher::instance() {
+  static FdWatcher* watcher = new FdWatcher();
+  return *watcher;
+}
+
+bool FdWatcher::wait(int fd, uint32_t events, int timeout_ms) {
+  FdWatcher& watcher = instance();
+  Waiter w;
+  uint32_t seq;
+  bool registered;
+  {
+    std::lock_guard<std::mutex> lock(watcher.mu_);
+    auto p = watcher.fds_.find(fd);
+    registered = p != watcher.fds_.end();
+    if (registered && p->second.waiter != nullptr) {
+      errno = EEXIST;
+      return false;
+    }
+    Registration& r = registered ? p->second : watcher.fds_[fd];
+    r.waiter = &w;
+    seq = registered ? r.seq + 1 : 0;
+    r.seq = seq;
+  }
+  // the fd is reserved by r.waiter, arm it outside mu_
+  struct epoll_event evt;
+  evt.events = events | EPOLLONESHOT;
+  evt.data.u64 = tag(fd, seq);
+  int rc = -1;
+  if (registered) {
+    rc = epoll_ctl(watcher.epfd_, EPOLL_CTL_MOD, fd, &evt);
+  }
+  if (rc != 0 && (!registered || errno == ENOENT)) {
+    // first wait, or the fd was closed and its number reused
+    rc = epoll_ctl(watcher.epfd_, EPOLL_CTL_ADD, fd, &evt);
+    if (rc != 0 && errno == EEXIST) {
+      // still in epfd_ although a failed wait dropped its registration
+      rc = epoll_ctl(watcher.epfd_, EPOLL_CTL_MOD, fd, &evt);
+    }
+  }
+  bool ready = false;
+  int err = 0;
+  if (rc != 0) {
+    err = errno;
+  } else if (timeout_ms < 0) {
+    w.ready.acquire();
+    ready = true;
+  } else {
+    ready = w.ready.try_acquire_for(std::chrono::milliseconds(timeout_ms));
+    err = ready ? 0 : ETIMEDOUT;
+  }
+  {
+    // after the waiter is cleared under mu_, run() no longer touches w
+    std::lock_guard<std::mutex> lock(watcher.mu_);
+    if (rc != 0) {
+      watcher.fds_.erase(fd);
+    } else {
+      watcher.fds_[fd].waiter = nullptr;
+    }
+  }
+  if (!ready) {
+    errno = err;
+  }
+  return ready;
+}
+
+void FdWatcher::run() {
+  struct epoll_event events[64];
+  for (;;) {
+    int n = epoll_wait(epfd_, events, 64, -1);
+    if (n < 0) {
+      if (errno != EINTR) {
+        LOG_ERROR(FD_WATCHER_LOG_ID,
+                  utils::fmt::sprintf("epoll_wait failed, epfd:%d, errno:%d",
+                                      epfd_, errno));
+      }
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    for (int i = 0; i < n; ++i) {
+      uint64_t t = events[i].data.u64;
+      auto p = fds_.find(static_cast<int>(static_cast<uint32_t>(t)));
+      if (p != fds_.end() && p->second.waiter != nullptr &&
+          tag(p->first, p->second.seq) == t) {
+        p->second.waiter->ready.release();
+      }
+    }
+  }
+}
+
+}  // namespace net
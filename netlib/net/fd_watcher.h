@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include "task_coroutine/task_sync.h"
+
+namespace net {
+
+// FdWatcher parks a coroutine until a fd is ready, without holding a worker
+// thread or an offload thread. One watcher thread per process blocks in
+// epoll_wait on an epoll fd of its own and wakes the parked waiters.
+class FdWatcher {
+ public:
+  FdWatcher(const FdWatcher&) = delete;
+
+  FdWatcher& operator=(const FdWatcher&) = delete;
+
+  // wait parks the calling coroutine (or blocks the calling thread outside a
+  // coroutine) until fd reports one of events (EPOLLIN, EPOLLOUT, ...) or
+  // timeout_ms passes, timeout_ms < 0 means no timeout.
+  // return false with errno set on timeout (ETIMEDOUT) or failure.
+  // a wakeup may be spurious, callers retry the operation that would block.
+  // a fd can have only one waiter at a time, a second one fails with EEXIST.
+  // a fd stays registered after the wait and later waits re-arm it with
+  // EPOLL_CTL_MOD, the kernel drops the registration when the fd is closed.
+  static bool wait(int fd, uint32_t events, int timeout_ms);
+
+ private:
+  struct Waiter {
+    task_coroutine::CoSemaphore ready;
+  };
+
+  // Registration is the state of a fd registered in epfd_.
+  struct Registration {
+    Waiter* waiter;  // nullptr when nobody waits
+    uint32_t seq;    // bumped by every wait, tags the events of that wait
+  };
+
+  FdWatcher();
+
+  static FdWatcher& instance();
+
+  // tag packs fd and seq into epoll_event.data.u64
+  static uint64_t tag(int fd, uint32_t seq) {
+    return static_cast<uint64_t>(seq) << 32 | static_cast<uint32_t>(fd);
+  }
+
+  void run();
+
+  int epfd_;
+  std::mutex mu_;
+  // registered fds, an event whose seq is not the current one (its waiter
+  // has already left) is dropped
+  std::unordered_map<int, Registration> fds_;
+};
+
+}  // namespace net
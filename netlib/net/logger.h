@@ -6,4 +6,5 @@
 namespace net {
 constexpr const char* EPOLLER_LOG_ID = "NET_EPOLL";
 constexpr const char* LISTENER_LOG_ID = "LISTENER";
+constexpr const char* FD_WATCHER_LOG_ID = "FD_WATCHER";
 }  // namespace net
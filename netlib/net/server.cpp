@@ -1,11 +1,11 @@
 #include "server.h"
 
-#include <thread>
 #include <utility>
 #include <vector>
 
 #include "connection.h"
 #include "fd_operator.h"
+#include "fd_watcher.h"
 #include "net_pool.h"
 #include "task_coroutine/task_coroutine.h"
 
@@ -23,7 +23,8 @@ bool Server::start() {
   // must set new_connectino_handler.
   assert(new_connection_handler_ != nullptr);
 
-  size_t n = static_cast<size_t>(std::thread::hardware_concurrency());
+  // one epoller per task_coroutine worker thread.
+  size_t n = task_coroutine::TaskControl::get()->task_groups_num();
   if (n == 0) {
     n = DEFAULT_EPOLLER_NUM;
   }
@@ -36,16 +37,27 @@ bool Server::start() {
   // n is the number of epollers
   n_ = n;
   for (size_t i = 1; i < n; ++i) {
-    task_coroutine::Coroutine c(event_loop, &epollers_[i]);
+    Epoller* epoller = &epollers_[i];
+    // event loops run at I/O priority so bursts of handler/batch work do not
+    // delay epoll processing
+    if (!task_coroutine::spawn([epoller]() { event_loop(epoller); },
+                               task_coroutine::TaskPriority::IO)
+             .valid()) {
+      // out of memory for a coroutine: only use the epollers whose event
+      // loop is running, epollers_[0] is served by this thread
+      n_ = i;
+      break;
+    }
   }
 
   // listener run in the thread which call start()
   FDOperator ln_operator(ln_.fd());
   ln_operator.set_handle_read(listener_default_handler, this);
-  choose_index_ = 1 == n ? 0 : 1;
+  choose_index_ = 1 == n_ ? 0 : 1;
   epollers_[0].control(&ln_operator, Epoller::Event::ADD_R);
   for (;;) {
-    epollers_[0].wait(true);
+    // not a coroutine: block in epoll_wait until events arrive
+    epollers_[0].wait(-1);
   }
   return true;
 }
@@ -55,18 +67,14 @@ Epoller& Server::choose_one_epoller() {
   return epollers_[choose_index_];
 }
 
-void* Server::event_loop(void* arg) {
-  Epoller* epoller = (Epoller*)arg;
-  int timeout = 0;
+void Server::event_loop(Epoller* epoller) {
   for (;;) {
-    if (epoller->wait(timeout)) {
-      timeout = 0;
-    } else {
-      task_coroutine::Coroutine::yield();
-      timeout = 5;
+    if (!epoller->wait(0)) {
+      // no events: park until the epoll fd becomes readable instead of
+      // blocking the worker thread in epoll_wait
+      FdWatcher::wait(epoller->fd(), EPOLLIN, -1);
     }
   }
-  return nullptr;
 }
 
 void Server::listener_default_handler(void* arg) {
@@ -26,7 +26,7 @@ class Server {
   Epoller& choose_one_epoller();
 
   // epoller run in task_coroutine::Coroutine
-  static void* event_loop(void* arg);
+  static void event_loop(Epoller* epoller);
 
   // listener default read callback.
   static void listener_default_handler(void* arg);
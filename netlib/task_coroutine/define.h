@@ -4,7 +4,28 @@
 // 是否开启debug
 // #define TASK_COROUTINE_DEBUG 0
 
-// 是否使用ParkingLot
-#define USE_PARKING_LOT 0
+// 是否开启协程注册表，见task_registry.h，定义TASK_COROUTINE_NO_REGISTRY关闭
+#ifndef TASK_COROUTINE_NO_REGISTRY
+#define TASK_COROUTINE_REGISTRY 1
+#endif
 
-#endif // !__TASK_COROUTINE_DEFINE_H__
\ No newline at end of file
+// 是否使用-fsanitize=address/thread编译，开启时切换协程通知sanitizer，见task_sanitizer.h
+#if defined(__SANITIZE_ADDRESS__)
+#define TASK_COROUTINE_ASAN 1
+#endif
+#if defined(__SANITIZE_THREAD__)
+#define TASK_COROUTINE_TSAN 1
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) && !defined(TASK_COROUTINE_ASAN)
+#define TASK_COROUTINE_ASAN 1
+#endif
+#if __has_feature(thread_sanitizer) && !defined(TASK_COROUTINE_TSAN)
+#define TASK_COROUTINE_TSAN 1
+#endif
+#endif
+#if defined(TASK_COROUTINE_ASAN) || defined(TASK_COROUTINE_TSAN)
+#define TASK_COROUTINE_SANITIZER 1
+#endif
+
+#endif // !__TASK_COROUTINE_DEFINE_H__
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace task_coroutine {
+
+// StackType 协程栈的大小类别，栈通过mmap分配，最低地址处有一个PROT_NONE的保护页
+// 默认栈从原来malloc分配的8KB改为NORMAL的64KB，未使用的页不占物理内存；
+// 需要原来的大小时使用SMALL
+enum class StackType {
+  SMALL = 0,    // 8KB，用于不会深度调用的小任务
+  NORMAL = 1,   // 64KB，默认
+  LARGE = 2,    // 1MB，用于深度递归等栈消耗大的任务
+  COMPACT = 3,  // 64KB，换出时释放栈指针以下的物理页，用于大量长时间park的协程，见task_stack.h
+};
+
+constexpr size_t STACK_TYPE_NUM = 4;
+
+// TaskPriority 协程的优先级类别，工作线程按权重从各类别的队列中取任务，
+// 高优先级不会完全饿死低优先级
+enum class TaskPriority {
+  IO = 0,           // 事件循环等I/O任务，权重最高
+  INTERACTIVE = 1,  // 请求处理等交互任务，默认
+  BATCH = 2,        // 计算密集的批处理任务，被唤醒时不放入runnext
+};
+
+constexpr size_t TASK_PRIORITY_NUM = 3;
+
+// TaskAttr 创建协程时的属性
+// file/line默认为构造TaskAttr的位置，作为默认参数时即为创建协程的位置（spawn site），
+// 用于监控线程报告长时间运行的协程
+struct TaskAttr {
+  StackType stack_type;
+  TaskPriority priority;
+  const char* file;
+  int line;
+
+  constexpr TaskAttr(StackType stack_type_ = StackType::NORMAL,
+                     TaskPriority priority_ = TaskPriority::INTERACTIVE,
+                     const char* file_ = __builtin_FILE(),
+                     int line_ = __builtin_LINE())
+      : stack_type(stack_type_),
+        priority(priority_),
+        file(file_),
+        line(line_) {}
+
+  constexpr TaskAttr(TaskPriority priority_,
+                     const char* file_ = __builtin_FILE(),
+                     int line_ = __builtin_LINE())
+      : stack_type(StackType::NORMAL),
+        priority(priority_),
+        file(file_),
+        line(line_) {}
+};
+
+}  // namespace task_coroutine
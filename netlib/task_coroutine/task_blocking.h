@@ -0,0 +1,18 @@
+#pragma once
+
+#include "utils/task_hooks.h"
+
+namespace task_coroutine {
+
+// 阻塞调用标记
+// 无法卸载的阻塞调用（第三方库、条件变量等）前后用BlockingScope标记。
+// 工作线程在阻塞调用中超过TaskControlOptions::blocking_handoff_ms且本地队列还有任务时，
+// 监控线程启动临时线程接手这些任务，避免它们一直等待阻塞的工作线程。
+// 进入和退出各只有一次原子读、间接调用、一次原子写和一次共享计数的原子加减的开销
+// BlockingScope通过utils/task_hooks.h中的g_enter_blocking_fn/g_exit_blocking_fn调用，
+// 基础模块直接使用utils中的版本
+
+using utils::blocking;
+using utils::BlockingScope;
+
+}  // namespace task_coroutine
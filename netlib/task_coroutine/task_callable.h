@@ -0,0 +1,69 @@
+#pragma once
+
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "task_meta.h"
+
+namespace task_coroutine {
+
+// TaskResult 协程的返回值
+template <typename R>
+struct TaskResult {
+  std::optional<R> value;
+};
+
+template <>
+struct TaskResult<void> {};
+
+// TaskCallable 可调用对象及其返回值，构造在协程栈顶保留的内存中（TaskMeta::reserved_memory），
+// 不需要额外分配内存。作为TaskMeta的arg，run为TaskMeta的fn，destroy为TaskMeta的destroy_fn
+// 1. 可调用对象在协程中调用完成后立即析构，捕获的状态不会比协程活得更久
+// 2. 返回值保留到TaskMeta销毁，join时取出；R为void时丢弃可调用对象的返回值
+template <typename F, typename R>
+struct TaskCallable : TaskResult<R> {
+  static_assert(alignof(F) <= 16, "callable is over-aligned");
+
+  template <typename... Args>
+  explicit TaskCallable(Args&&... args) {
+    new (storage) F(std::forward<Args>(args)...);
+  }
+
+  TaskCallable(const TaskCallable&) = delete;
+  TaskCallable& operator=(const TaskCallable&) = delete;
+
+  // emplace 以args构造F，在task栈顶保留的内存中，task需要以sizeof(TaskCallable)保留内存创建
+  template <typename... Args>
+  static void emplace(TaskMeta* task, Args&&... args) {
+    task->arg = new (task->reserved_memory(sizeof(TaskCallable)))
+        TaskCallable(std::forward<Args>(args)...);
+    task->destroy_fn = destroy;
+  }
+
+  static void* run(void* arg) {
+    TaskCallable* c = static_cast<TaskCallable*>(arg);
+    F* f = reinterpret_cast<F*>(c->storage);
+    if constexpr (std::is_void<R>::value) {
+      (*f)();
+    } else {
+      c->value.emplace((*f)());
+    }
+    f->~F();
+    return nullptr;
+  }
+
+  static void destroy(void* arg) {
+    static_cast<TaskCallable*>(arg)->~TaskCallable();
+  }
+
+  alignas(F) unsigned char storage[sizeof(F)];
+};
+
+// TaskCallableResult 可调用对象F无参数调用的返回值类型，引用类型按值保存
+template <typename F>
+using TaskCallableResult =
+    typename std::decay<std::invoke_result_t<typename std::decay<F>::type&>>::type;
+
+}  // namespace task_coroutine
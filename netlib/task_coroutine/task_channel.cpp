@@ -0,0 +1,219 @@
+#include "task_channel.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "task_control.h"
+#include "task_group.h"
+
+namespace task_coroutine {
+
+ChannelWaiter* ChannelBase::pop_claimed(WaiterList<ChannelWaiter>* q) {
+  while (ChannelWaiter* cw = q->pop_front()) {
+    cw->queued = false;
+    if (cw->claim()) {
+      return cw;
+    }
+    // select的其他case已经完成，丢弃
+  }
+  return nullptr;
+}
+
+bool ChannelBase::send_locked(void* value, bool* ok, TaskWaiter** to_wake) {
+  if (closed_) {
+    *ok = false;
+    return true;
+  }
+  if (ChannelWaiter* cw = pop_claimed(&recvq_)) {
+    move_value(cw->value, value);
+    *cw->ok = true;
+    *to_wake = cw->waiter;
+    *ok = true;
+    return true;
+  }
+  if (size_ < capacity_) {
+    buffer_push(value);
+    ++size_;
+    *ok = true;
+    return true;
+  }
+  return false;
+}
+
+bool ChannelBase::recv_locked(void* out, bool* ok, TaskWaiter** to_wake) {
+  if (size_ > 0) {
+    buffer_pop(out);
+    --size_;
+    // 缓冲区空出位置，补充一个等待中的发送者
+    if (ChannelWaiter* cw = pop_claimed(&sendq_)) {
+      buffer_push(cw->value);
+      ++size_;
+      *cw->ok = true;
+      *to_wake = cw->waiter;
+    }
+    *ok = true;
+    return true;
+  }
+  if (ChannelWaiter* cw = pop_claimed(&sendq_)) {
+    move_value(out, cw->value);
+    *cw->ok = true;
+    *to_wake = cw->waiter;
+    *ok = true;
+    return true;
+  }
+  if (closed_) {
+    *ok = false;
+    return true;
+  }
+  return false;
+}
+
+bool ChannelBase::send(void* value, bool block) {
+  bool ok = false;
+  TaskWaiter* to_wake = nullptr;
+  mu_.lock();
+  if (send_locked(value, &ok, &to_wake) || !block) {
+    mu_.unlock();
+    if (to_wake != nullptr) {
+      TaskGroup::wake(to_wake);
+    }
+    return ok;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  ChannelWaiter cw(&w, value, &ok);
+  cw.queued = true;
+  sendq_.push_back(&cw);
+  TaskGroup::wait_unlock(&w, &mu_);
+  return ok;
+}
+
+bool ChannelBase::recv(void* out, bool block) {
+  bool ok = false;
+  TaskWaiter* to_wake = nullptr;
+  mu_.lock();
+  if (recv_locked(out, &ok, &to_wake) || !block) {
+    mu_.unlock();
+    if (to_wake != nullptr) {
+      TaskGroup::wake(to_wake);
+    }
+    return ok;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  ChannelWaiter cw(&w, out, &ok);
+  cw.queued = true;
+  recvq_.push_back(&cw);
+  TaskGroup::wait_unlock(&w, &mu_);
+  return ok;
+}
+
+void ChannelBase::close() {
+  WaiterList<ChannelWaiter> waiters;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    while (ChannelWaiter* cw = pop_claimed(&recvq_)) {
+      waiters.push_back(cw);
+    }
+    while (ChannelWaiter* cw = pop_claimed(&sendq_)) {
+      waiters.push_back(cw);
+    }
+  }
+  while (ChannelWaiter* cw = waiters.pop_front()) {
+    *cw->ok = false;
+    TaskGroup::wake(cw->waiter);
+  }
+}
+
+void Select::lock_all() {
+  if (locked_.empty()) {
+    for (auto& c : cases_) {
+      locked_.push_back(c.ch);
+    }
+    // 按地址顺序加锁，避免多个select之间死锁
+    std::sort(locked_.begin(), locked_.end());
+    locked_.erase(std::unique(locked_.begin(), locked_.end()), locked_.end());
+  }
+  for (ChannelBase* ch : locked_) {
+    ch->mu_.lock();
+  }
+}
+
+void Select::unlock_all() {
+  for (auto it = locked_.rbegin(); it != locked_.rend(); ++it) {
+    (*it)->mu_.unlock();
+  }
+}
+
+int Select::select(bool block) {
+  if (cases_.empty()) {
+    return -1;
+  }
+  size_t n = cases_.size();
+  lock_all();
+  // 1. 从随机位置开始检查是否有就绪的case，避免总是选中前面的case
+  size_t start = tls_random_number.generate() % n;
+  for (size_t k = 0; k < n; ++k) {
+    size_t i = (start + k) % n;
+    Case& c = cases_[i];
+    bool ok = false;
+    TaskWaiter* to_wake = nullptr;
+    bool done = c.is_send ? c.ch->send_locked(c.value, &ok, &to_wake)
+                          : c.ch->recv_locked(c.value, &ok, &to_wake);
+    if (done) {
+      unlock_all();
+      if (to_wake != nullptr) {
+        TaskGroup::wake(to_wake);
+      }
+      if (c.ok != nullptr) {
+        *c.ok = ok;
+      }
+      return static_cast<int>(i);
+    }
+  }
+  if (!block) {
+    unlock_all();
+    return -1;
+  }
+
+  // 2. 在所有channel上登记等待者，第一个完成的case取得等待者
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  std::atomic<int> selected(-1);
+  std::unique_ptr<bool[]> results(new bool[n]());
+  std::vector<ChannelWaiter> cws;
+  cws.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    Case& c = cases_[i];
+    cws.emplace_back(&w, c.value, &results[i]);
+    ChannelWaiter& cw = cws.back();
+    cw.index = static_cast<int>(i);
+    cw.selected = &selected;
+    cw.queued = true;
+    (c.is_send ? c.ch->sendq_ : c.ch->recvq_).push_back(&cw);
+  }
+  TaskGroup::wait(
+      &w, [](void* sel) -> void { static_cast<Select*>(sel)->unlock_all(); },
+      this);
+
+  // 3. 从其他channel的等待队列中移除
+  lock_all();
+  for (size_t i = 0; i < n; ++i) {
+    if (cws[i].queued) {
+      Case& c = cases_[i];
+      (c.is_send ? c.ch->sendq_ : c.ch->recvq_).erase(&cws[i]);
+    }
+  }
+  unlock_all();
+  int i = selected.load(std::memory_order_acquire);
+  if (cases_[i].ok != nullptr) {
+    *cases_[i].ok = results[i];
+  }
+  return i;
+}
+
+}  // namespace task_coroutine
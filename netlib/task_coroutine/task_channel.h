@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "task_waiter.h"
+#include "utils/spin_mutex.h"
+
+namespace task_coroutine {
+
+// ChannelWaiter 阻塞在channel上的发送者或接收者
+struct ChannelWaiter {
+  TaskWaiter* waiter;
+  void* value;  // 发送者：待发送的值；接收者：存放接收值的地址
+  bool* ok;     // 操作结果，channel关闭时为false
+  int index;    // select中case的下标
+  std::atomic<int>* selected;  // select的所有case共享，nullptr表示不是select
+  bool queued;                 // 是否在channel的等待队列中
+  ChannelWaiter* prev;
+  ChannelWaiter* next;
+
+  ChannelWaiter(TaskWaiter* waiter_, void* value_, bool* ok_)
+      : waiter(waiter_),
+        value(value_),
+        ok(ok_),
+        index(0),
+        selected(nullptr),
+        queued(false),
+        prev(nullptr),
+        next(nullptr) {}
+
+  // claim 唤醒者取得该等待者，select时只有第一个完成的case能取得
+  bool claim() {
+    int expected = -1;
+    return selected == nullptr ||
+           selected->compare_exchange_strong(expected, index,
+                                             std::memory_order_acq_rel);
+  }
+};
+
+class Select;
+
+// ChannelBase 与元素类型无关的channel实现，元素的移动由Channel<T>实现
+class ChannelBase {
+  friend class Select;
+
+ public:
+  ChannelBase(const ChannelBase&) = delete;
+  ChannelBase& operator=(const ChannelBase&) = delete;
+
+  // close 关闭channel，唤醒所有等待者；关闭后send失败，recv取完缓冲区后失败
+  void close();
+
+  bool closed() const {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    return closed_;
+  }
+
+  size_t size() const {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    return size_;
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ protected:
+  explicit ChannelBase(size_t capacity)
+      : capacity_(capacity), size_(0), closed_(false) {}
+
+  virtual ~ChannelBase() {}
+
+  // buffered 缓冲区中的元素个数，需要持有mu_，供buffer_push/buffer_pop使用
+  size_t buffered() const { return size_; }
+
+  // buffer_push 把*value移动到缓冲区尾部
+  virtual void buffer_push(void* value) = 0;
+
+  // buffer_pop 把缓冲区头部的元素移动到*out
+  virtual void buffer_pop(void* out) = 0;
+
+  // move_value *dst = std::move(*src)
+  virtual void move_value(void* dst, void* src) = 0;
+
+  bool send(void* value, bool block);
+
+  bool recv(void* out, bool block);
+
+ private:
+  // send_locked/recv_locked 持有mu_时尝试完成操作
+  // 返回值：true表示完成，结果在*ok中，*to_wake为需要在释放mu_后唤醒的等待者
+  bool send_locked(void* value, bool* ok, TaskWaiter** to_wake);
+
+  bool recv_locked(void* out, bool* ok, TaskWaiter** to_wake);
+
+  // pop_claimed 从队列中取出第一个能取得的等待者
+  static ChannelWaiter* pop_claimed(WaiterList<ChannelWaiter>* q);
+
+  const size_t capacity_;
+  mutable utils::SpinMutex mu_;
+  size_t size_;  // 缓冲区中的元素个数
+  bool closed_;
+  WaiterList<ChannelWaiter> recvq_;
+  WaiterList<ChannelWaiter> sendq_;
+};
+
+// Channel 有界的多生产者多消费者队列，capacity为0时发送者与接收者直接交接
+template <typename T>
+class Channel : public ChannelBase {
+ public:
+  explicit Channel(size_t capacity = 0)
+      : ChannelBase(capacity), buf_(capacity), head_(0) {}
+
+  // send 发送，缓冲区满时等待，channel关闭时返回false
+  bool send(const T& value) {
+    T v(value);
+    return ChannelBase::send(&v, true);
+  }
+
+  bool send(T&& value) { return ChannelBase::send(&value, true); }
+
+  // try_send 不等待，缓冲区满或channel关闭时返回false
+  bool try_send(const T& value) {
+    T v(value);
+    return ChannelBase::send(&v, false);
+  }
+
+  bool try_send(T&& value) { return ChannelBase::send(&value, false); }
+
+  // recv 接收，缓冲区空时等待，channel关闭且缓冲区空时返回false
+  bool recv(T& out) { return ChannelBase::recv(&out, true); }
+
+  // try_recv 不等待，没有可接收的值时返回false
+  bool try_recv(T& out) { return ChannelBase::recv(&out, false); }
+
+ protected:
+  void buffer_push(void* value) override {
+    buf_[(head_ + buffered()) % capacity()] =
+        std::move(*static_cast<T*>(value));
+  }
+
+  void buffer_pop(void* out) override {
+    *static_cast<T*>(out) = std::move(buf_[head_]);
+    head_ = (head_ + 1) % capacity();
+  }
+
+  void move_value(void* dst, void* src) override {
+    *static_cast<T*>(dst) = std::move(*static_cast<T*>(src));
+  }
+
+ private:
+  std::vector<T> buf_;  // 环形缓冲区
+  size_t head_;
+};
+
+// Select 同时等待多个channel上的发送/接收，完成其中一个
+//   Select sel;
+//   sel.recv(ch1, &v1).send(ch2, &v2);
+//   int i = sel.wait();  // 完成的case下标
+class Select {
+ public:
+  Select() {}
+
+  Select(const Select&) = delete;
+  Select& operator=(const Select&) = delete;
+
+  // recv 添加接收case，ok为nullptr时忽略channel是否关闭
+  template <typename T>
+  Select& recv(Channel<T>& ch, T* out, bool* ok = nullptr) {
+    cases_.push_back(Case{&ch, false, out, ok});
+    return *this;
+  }
+
+  // send 添加发送case，完成时*value被移动
+  template <typename T>
+  Select& send(Channel<T>& ch, T* value, bool* ok = nullptr) {
+    cases_.push_back(Case{&ch, true, value, ok});
+    return *this;
+  }
+
+  // wait 等待直到一个case完成，返回其下标
+  int wait() { return select(true); }
+
+  // try_wait 没有就绪的case时返回-1
+  int try_wait() { return select(false); }
+
+ private:
+  struct Case {
+    ChannelBase* ch;
+    bool is_send;
+    void* value;
+    bool* ok;
+  };
+
+  int select(bool block);
+
+  void lock_all();
+
+  void unlock_all();
+
+  std::vector<Case> cases_;
+  std::vector<ChannelBase*> locked_;  // 按地址排序、去重后的channel
+};
+
+}  // namespace task_coroutine
@@ -1,29 +1,65 @@
 #include "task_context.h"
 
+// 1. task_coroutine_jump_fcontext带有CFI，在切换过程中采样（perf record -g）、gdb中断时也能回溯；
+//    切换栈后新栈的布局与保存时相同，CFA仍然是rsp + 0x40
+// 2. 新协程栈的最外层帧为task_coroutine_finish_fcontext：rbp为0，返回地址的CFI标记rip未定义，
+//    基于帧指针和基于CFI的回溯都在这里正常结束
+// 栈布局（从低地址到高地址）：对齐 r12 r13 r14 r15 rbx rbp 返回地址
+
 __asm(
     ".text\n"
     ".globl task_coroutine_jump_fcontext\n"
     ".type task_coroutine_jump_fcontext,@function\n"
     ".align 16\n"
     "task_coroutine_jump_fcontext:\n"
+    "    .cfi_startproc\n"
     "    pushq  %rbp  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %rbp, 0\n"
     "    pushq  %rbx  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %rbx, 0\n"
     "    pushq  %r15  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %r15, 0\n"
     "    pushq  %r14  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %r14, 0\n"
     "    pushq  %r13  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %r13, 0\n"
     "    pushq  %r12  \n"
+    "    .cfi_adjust_cfa_offset 8\n"
+    "    .cfi_rel_offset %r12, 0\n"
     "    leaq  -0x8(%rsp), %rsp\n"
+    "    .cfi_adjust_cfa_offset 8\n"
     "    movq  %rsp, (%rdi)\n"
     "    movq  %rsi, %rsp\n"
     "    leaq  0x8(%rsp), %rsp\n"
+    "    .cfi_adjust_cfa_offset -8\n"
     "    popq  %r12  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %r12\n"
     "    popq  %r13  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %r13\n"
     "    popq  %r14  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %r14\n"
     "    popq  %r15  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %r15\n"
     "    popq  %rbx  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %rbx\n"
     "    popq  %rbp  \n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_restore %rbp\n"
     "    popq  %r8\n"
+    "    .cfi_adjust_cfa_offset -8\n"
+    "    .cfi_register %rip, %r8\n"
     "    jmp  *%r8\n"
+    "    .cfi_endproc\n"
     ".size task_coroutine_jump_fcontext,.-task_coroutine_jump_fcontext\n"
     ".section .note.GNU-stack,\"\",%progbits\n"
     ".previous\n");
@@ -34,14 +70,28 @@ __asm(
     ".type task_coroutine_make_fcontext, @function\n"
     ".align 16\n"
     "task_coroutine_make_fcontext:\n"
+    "   .cfi_startproc\n"
     "   movq    %rdi, %rax\n"
     "   andq    $-16, %rax\n"
     "   leaq    -0x48(%rax), %rax\n"
+    "   movq    $0, 0x30(%rax)\n"
     "   movq    %rsi, 0x38(%rax)\n"
-    "   leaq    finish(%rip), %rcx\n"
+    "   leaq    .Ltask_coroutine_finish(%rip), %rcx\n"
     "   movq    %rcx, 0x40(%rax)\n"
     "   ret\n"
-    "finish:\n"
+    "   .cfi_endproc\n"
+    ".size task_coroutine_make_fcontext,.-task_coroutine_make_fcontext\n"
+    "\n"
+    // 返回地址为.Ltask_coroutine_finish，unwinder用返回地址-1查找FDE，前面的nop属于本函数
+    ".type task_coroutine_finish_fcontext, @function\n"
+    ".align 16\n"
+    "task_coroutine_finish_fcontext:\n"
+    "   .cfi_startproc\n"
+    "   .cfi_undefined %rip\n"
+    "   nop\n"
+    ".Ltask_coroutine_finish:\n"
     "   xorq    %rdi, %rdi\n"
     "   call    _exit@PLT\n"
-    "   hlt\n");
\ No newline at end of file
+    "   hlt\n"
+    "   .cfi_endproc\n"
+    ".size task_coroutine_finish_fcontext,.-task_coroutine_finish_fcontext\n");
@@ -2,49 +2,275 @@
 
 #include <assert.h>
 #include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <mutex>
+
+#include "task_blocking.h"
 #include "task_group.h"
+#include "task_offload.h"
+#include "task_timer.h"
+#include "task_yield.h"
 
 namespace task_coroutine {
 
-TaskControl* g_task_control = nullptr;
+std::atomic<TaskControl*> g_task_control(nullptr);
 
 thread_local utils::RandomNumber tls_random_number(
-    0, TaskControl::task_groups_num() - 1);
+    0, std::numeric_limits<size_t>::max());
+
+bool TaskControl::init(const TaskControlOptions& options) {
+  static std::once_flag once;
+  bool done = false;
+  std::call_once(once, [&options, &done]() -> void {
+    TaskControl* tc = new (std::nothrow) TaskControl(options);
+    assert(tc != nullptr);
+    tc->start_worker_threads();
+    g_task_control.store(tc, std::memory_order_release);
+    done = true;
+  });
+  return done;
+}
 
-TaskControl::Init::Init() {
-  g_task_control =
-      new (std::nothrow) TaskControl();
-  assert(g_task_control != nullptr);
-  g_task_control->start_worker_threads();
+std::vector<int> TaskControl::available_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, &set)) {
+        cpus.push_back(i);
+      }
+    }
+  }
+  return cpus;
 }
 
-TaskControl::Init TaskControl::init_;
+static size_t default_task_groups_num() {
+  size_t n = TaskControl::available_cpus().size();
+  if (n == 0) {
+    n = static_cast<size_t>(std::thread::hardware_concurrency());
+  }
+  return n == 0 ? 1 : n;
+}
 
-TaskControl::TaskControl()
-    : init_success_num_(0) {
+TaskControl::TaskControl(const TaskControlOptions& options)
+    : task_groups_num_(options.task_groups_num != 0 ? options.task_groups_num
+                                                    : default_task_groups_num()),
+      bind_cpu_(options.bind_cpu),
+      time_slice_ns_(options.time_slice_ms * 1000000),
+      offload_max_threads_(options.offload_max_threads),
+      blocking_handoff_ns_(options.blocking_handoff_ms * 1000000),
+      spare_max_threads_(options.spare_max_threads != 0
+                             ? options.spare_max_threads
+                             : task_groups_num_),
+      init_success_num_(0),
+      nspinning_(0),
+      nidle_(0),
+      nhandoffs_(0),
+      nblocking_(0),
+      monitor_parked_(false) {
   worker_threads_ = new (std::nothrow) std::thread[task_groups_num()];
   task_groups_ = new (std::nothrow) TaskGroup*[task_groups_num()];
-  parking_lots_ = new (std::nothrow) ParkingLot[parking_lots_num()];
-  assert(worker_threads_ != nullptr && task_groups_ != nullptr &&
-         parking_lots_ != nullptr);
+  assert(worker_threads_ != nullptr && task_groups_ != nullptr);
+  idle_groups_.reserve(task_groups_num());
 }
 
 TaskControl::~TaskControl() {
   for (size_t i = 0; i < task_groups_num(); ++i) {
     worker_threads_[i].join();
   }
+  if (monitor_thread_.joinable()) {
+    monitor_thread_.join();
+  }
   delete[] worker_threads_;
   delete[] task_groups_;
-  delete[] parking_lots_;
 }
 
 void TaskControl::start_worker_threads() {
+  TaskGroup::install_stack_overflow_handler();
+  std::vector<int> cpus;
+  if (bind_cpu_) {
+    cpus = available_cpus();
+  }
   for (size_t i = 0; i < task_groups_num(); ++i) {
     // 开启工作线程，启动函数为run_main_task
     worker_threads_[i] = std::thread(&TaskGroup::run_main_task, this, i);
+    if (!cpus.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+      pthread_setaffinity_np(worker_threads_[i].native_handle(), sizeof(set),
+                             &set);
+    }
   }
   wait_init_task_groups_completed();
+  utils::g_maybe_yield_fn.store(TaskGroup::maybe_yield,
+                                std::memory_order_relaxed);
+  OffloadPool::init(offload_max_threads_);
+  if (blocking_handoff_ns_ > 0) {
+    utils::g_exit_blocking_fn.store(TaskGroup::exit_blocking,
+                                    std::memory_order_relaxed);
+    utils::g_enter_blocking_fn.store(TaskGroup::enter_blocking,
+                                     std::memory_order_release);
+  }
+  if (time_slice_ns_ > 0 || blocking_handoff_ns_ > 0) {
+    monitor_thread_ = std::thread(&TaskControl::monitor, this);
+  }
+}
+
+// Sample 各task_group上次采样时正在运行的协程，调度序号不变说明一直是同一次运行
+struct TaskControl::Sample {
+  size_t seq;
+  TaskMeta* task;
+  int64_t since_ns;  // 第一次采样到这次运行的时间
+  bool reported;
+};
+
+void TaskControl::monitor() {
+  std::vector<Sample> samples(task_groups_num(), Sample{0, nullptr, 0, false});
+  constexpr int64_t blocking_interval_ns = 1000000;
+  int64_t interval_ns = time_slice_ns_ > 0
+                            ? std::max<int64_t>(time_slice_ns_ / 4, 1000000)
+                            : std::numeric_limits<int64_t>::max();
+  bool blocking = false;
+  for (;;) {
+    if (blocking) {
+      std::this_thread::sleep_for(
+          std::chrono::nanoseconds(blocking_interval_ns));
+    } else {
+      // 与add_blocking、sub_idle配对：先登记park再检查nblocking_和nidle_，
+      // 不会错过进入阻塞调用或离开空闲状态的工作线程
+      monitor_parked_.store(true, std::memory_order_seq_cst);
+      if (nblocking_.load(std::memory_order_seq_cst) == 0) {
+        // 所有工作线程都空闲时没有需要采样的协程，不设置超时
+        if (time_slice_ns_ > 0 &&
+            nidle_.load(std::memory_order_seq_cst) < task_groups_num()) {
+          monitor_parking_lot_.park_until(monotonic_ns() + interval_ns);
+        } else {
+          monitor_parking_lot_.park();
+        }
+      }
+      monitor_parked_.store(false, std::memory_order_relaxed);
+    }
+    int64_t now = monotonic_ns();
+    if (time_slice_ns_ > 0) {
+      check_time_slice(samples, now);
+    }
+    if (blocking_handoff_ns_ > 0) {
+      blocking = check_blocking(now);
+    }
+  }
+}
+
+void TaskControl::check_time_slice(std::vector<Sample>& samples, int64_t now) {
+  for (size_t i = 0; i < task_groups_num(); ++i) {
+    TaskGroup* g = task_groups_[i];
+    Sample& s = samples[i];
+    size_t seq = g->sched_seq();
+    TaskMeta* task = g->running_task();
+    if (task == nullptr || seq != s.seq || task != s.task) {
+      s = Sample{seq, task, now, false};
+      continue;
+    }
+    if (s.reported || now - s.since_ns < time_slice_ns_) {
+      continue;
+    }
+    // 协程运行超过时间片：设置should_yield，每次运行只报告一次
+    // 协程可能刚好结束并释放，不访问task，创建位置读取task_group切换时保存的副本，
+    // 读取之后调度序号变化说明已经切换，副本可能属于其他协程，不报告
+    g->request_yield();
+    s.reported = true;
+    const char* file = g->running_spawn_file();
+    int line = g->running_spawn_line();
+    if (g->sched_seq() != seq) {
+      continue;
+    }
+    fprintf(stderr,
+            "task_coroutine: task_meta = %p spawned at %s:%d has been "
+            "running for more than %ld ms on task_group %lu\n",
+            static_cast<void*>(task), file != nullptr ? file : "?", line,
+            static_cast<long>((now - s.since_ns) / 1000000), i);
+  }
+}
+
+bool TaskControl::check_blocking(int64_t now) {
+  bool blocking = false;
+  auto check = [this, now, &blocking](TaskGroup* g) -> void {
+    int64_t since = g->blocking_since_ns();
+    if (since == 0) {
+      return;
+    }
+    blocking = true;
+    if (now - since >= blocking_handoff_ns_ && g->has_queued_tasks()) {
+      start_spare(g);
+    }
+  };
+  for (size_t i = 0; i < task_groups_num(); ++i) {
+    check(task_groups_[i]);
+  }
+  // 临时线程运行的协程也可能阻塞，接手它窃取到本地的任务
+  std::vector<TaskGroup*> spares;
+  {
+    std::lock_guard<std::mutex> lock(spare_mu_);
+    spares = spare_groups_;
+  }
+  for (TaskGroup* g : spares) {
+    check(g);
+  }
+  return blocking;
+}
+
+void TaskControl::start_spare(TaskGroup* victim) {
+  TaskGroup* spare = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(spare_mu_);
+    size_t running = 0;
+    for (TaskGroup* g : spare_groups_) {
+      if (g->handoff_from() == nullptr) {
+        if (spare == nullptr) {
+          spare = g;
+        }
+        continue;
+      }
+      ++running;
+      if (g->handoff_from() == victim && g->blocking_since_ns() == 0) {
+        return;  // 已经有临时线程在接手
+      }
+    }
+    if (running >= spare_max_threads_) {
+      return;
+    }
+    if (spare == nullptr) {
+      spare = new (std::nothrow) TaskGroup(this, true);
+      assert(spare != nullptr);
+      spare_groups_.push_back(spare);
+    }
+    spare->set_handoff_from(victim);
+  }
+  nhandoffs_.fetch_add(1, std::memory_order_relaxed);
+  std::thread(&TaskGroup::run_spare_task, this, spare).detach();
+}
+
+void TaskControl::retire_spare(TaskGroup* spare) {
+  std::lock_guard<std::mutex> lock(spare_mu_);
+  spare->set_handoff_from(nullptr);
+}
+
+size_t TaskControl::spare_threads_num() const {
+  std::lock_guard<std::mutex> lock(spare_mu_);
+  size_t n = 0;
+  for (TaskGroup* g : spare_groups_) {
+    if (g->handoff_from() != nullptr) {
+      ++n;
+    }
+  }
+  return n;
 }
 
 void TaskControl::set_task_group(size_t i, TaskGroup* task_group) {
@@ -57,4 +283,118 @@ void TaskControl::wait_init_task_groups_completed() const {
     ;
 }
 
-}  // namespace task_coroutine
\ No newline at end of file
+void TaskControl::signal_task() {
+  // 与工作线程的add_idle -> sub_spinning -> 再次检查队列构成Dekker式同步，
+  // 要么这里看到空闲的工作线程，要么工作线程看到新的任务
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (nspinning_.load(std::memory_order_relaxed) != 0 ||
+      nidle_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  size_t expected = 0;
+  if (!nspinning_.compare_exchange_strong(expected, 1,
+                                          std::memory_order_seq_cst)) {
+    return;  // 其他工作线程开始自旋，由它寻找任务
+  }
+  TaskGroup* g = nullptr;
+  {
+    std::lock_guard<utils::SpinMutex> lock(idle_mu_);
+    if (!idle_groups_.empty()) {
+      g = idle_groups_.back();
+      idle_groups_.pop_back();
+      sub_idle(1);
+    }
+  }
+  if (g == nullptr) {
+    nspinning_.fetch_sub(1, std::memory_order_seq_cst);
+    return;
+  }
+  g->unpark();
+}
+
+void TaskControl::push_tasks(TaskMeta* const* tasks, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  TaskGroup* self = tls_task_group;
+  if (self != nullptr && !self->spare()) {
+    // 工作线程：本地保留一份，其余分给空闲的task_group并直接唤醒，
+    // 忙碌的task_group已经有任务，通过窃取平衡
+    std::vector<TaskGroup*> idle(std::min(task_groups_num() - 1, n - 1));
+    idle.resize(take_idle(idle.data(), idle.size()));
+    size_t chunk = (n + idle.size()) / (idle.size() + 1);
+    size_t pushed = chunk;
+    for (size_t i = 0; i < idle.size(); ++i) {
+      size_t m = std::min(chunk, n - pushed);
+      idle[i]->handoff_tasks(tasks + pushed, m);  // m为0时被唤醒后窃取
+      pushed += m;
+    }
+    self->push_tasks(tasks, chunk);
+    return;
+  }
+  // 非工作线程和临时线程：一次放入全局注入队列，取走的工作线程放入本地队列，其余工作线程窃取
+  inject_tasks(tasks, n);
+}
+
+size_t TaskControl::migration_count() const {
+  size_t n = 0;
+  for (size_t i = 0; i < task_groups_num(); ++i) {
+    n += task_groups_[i]->migration_count();
+  }
+  return n;
+}
+
+std::vector<TaskGroupStats> TaskControl::stats() const {
+  std::vector<TaskGroupStats> s;
+  s.reserve(task_groups_num());
+  for (size_t i = 0; i < task_groups_num(); ++i) {
+    s.push_back(task_groups_[i]->stats());
+  }
+  return s;
+}
+
+TaskGroupStats TaskControl::total_stats() const {
+  TaskGroupStats total;
+  for (size_t i = 0; i < task_groups_num(); ++i) {
+    total += task_groups_[i]->stats();
+  }
+  return total;
+}
+
+void TaskControl::add_idle(TaskGroup* task_group) {
+  std::lock_guard<utils::SpinMutex> lock(idle_mu_);
+  idle_groups_.push_back(task_group);
+  nidle_.fetch_add(1, std::memory_order_seq_cst);
+}
+
+size_t TaskControl::take_idle(TaskGroup** task_groups, size_t n) {
+  if (n == 0 || nidle_.load(std::memory_order_relaxed) == 0) {
+    return 0;
+  }
+  size_t got = 0;
+  {
+    std::lock_guard<utils::SpinMutex> lock(idle_mu_);
+    while (got < n && !idle_groups_.empty()) {
+      task_groups[got++] = idle_groups_.back();
+      idle_groups_.pop_back();
+    }
+    sub_idle(got);
+  }
+  nspinning_.fetch_add(got, std::memory_order_seq_cst);
+  return got;
+}
+
+bool TaskControl::remove_idle(TaskGroup* task_group) {
+  std::lock_guard<utils::SpinMutex> lock(idle_mu_);
+  for (size_t i = 0; i < idle_groups_.size(); ++i) {
+    if (idle_groups_[i] == task_group) {
+      idle_groups_[i] = idle_groups_.back();
+      idle_groups_.pop_back();
+      sub_idle(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace task_coroutine
@@ -1,41 +1,77 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <random>
 #include <thread>
+#include <vector>
 
 #include "define.h"
+#include "task_inject_queue.h"
 #include "task_parking_lot.h"
+#include "task_stats.h"
 #include "utils/random_number.h"
+#include "utils/spin_mutex.h"
 
 namespace task_coroutine {
 
 class TaskGroup;
 class TaskControl;
+struct TaskMeta;
 
-extern TaskControl* g_task_control;
+extern std::atomic<TaskControl*> g_task_control;
 extern thread_local utils::RandomNumber
     tls_random_number;  // 随机数生成器每个线程一个
 
-class TaskControl {
-  struct Init {
-    Init();
-  };
-
-  static Init init_;
-
- private:
-  static constexpr size_t TASK_GROUPS_NUM = 8;
-  static constexpr size_t PARKING_LOTS_NUM = 2;
+// TaskControlOptions TaskControl的初始化参数
+struct TaskControlOptions {
+  size_t task_groups_num;  // 工作线程数，0表示使用进程CPU亲和性掩码中可用的CPU数
+  bool bind_cpu;  // 是否将第i个工作线程绑定到亲和性掩码中的第i个CPU
+  // 协程连续运行超过time_slice_ms时，监控线程报告该协程及其创建位置，
+  // 并设置所在工作线程的should_yield标记（见task_yield.h），0表示不启动监控线程
+  int64_t time_slice_ms;
+  size_t offload_max_threads;  // offload线程池的最大线程数，见task_offload.h
+  // 工作线程在BlockingScope标记的阻塞调用中超过blocking_handoff_ms且本地队列还有任务时，
+  // 监控线程启动临时线程接手（见task_blocking.h），0表示不接手
+  int64_t blocking_handoff_ms;
+  size_t spare_max_threads;  // 同时运行的临时线程数上限，0表示与工作线程数相同
+
+  TaskControlOptions()
+      : task_groups_num(0),
+        bind_cpu(false),
+        time_slice_ms(100),
+        offload_max_threads(64),
+        blocking_handoff_ms(2),
+        spare_max_threads(0) {}
+};
 
+class TaskControl {
  public:
-  TaskControl();
+  explicit TaskControl(const TaskControlOptions& options);
 
   TaskControl(const TaskControl&) = delete;
   TaskControl& operator=(const TaskControl&) = delete;
 
   ~TaskControl();
 
+  // init 创建全局的TaskControl并启动工作线程，只有第一次调用生效
+  // 需要在创建第一个Coroutine之前调用，否则使用默认参数初始化
+  // 返回值：本次调用是否完成了初始化
+  static bool init(const TaskControlOptions& options = TaskControlOptions());
+
+  // get 获取全局的TaskControl，未初始化时使用默认参数初始化
+  static TaskControl* get() {
+    TaskControl* tc = g_task_control.load(std::memory_order_acquire);
+    if (tc == nullptr) {
+      init();
+      tc = g_task_control.load(std::memory_order_acquire);
+    }
+    return tc;
+  }
+
+  // available_cpus 进程CPU亲和性掩码中可用的CPU编号
+  static std::vector<int> available_cpus();
+
   // start_worker_threads 开启所有工作线程
   void start_worker_threads();
 
@@ -45,24 +81,150 @@ class TaskControl {
 
   // choose_one_task_group 并发安全，使用tls变量
   TaskGroup* choose_one_task_group() {
-    return task_groups_[tls_random_number.generate()];
+    return task_groups_[tls_random_number.generate() % task_groups_num_];
+  }
+
+  TaskGroup* task_group(size_t i) const { return task_groups_[i]; }
+
+  // push_tasks 批量入队TaskMeta::new_tasks创建的任务
+  // 任务分成连续的若干份，每个task_group最多一份，每份一次入队、一次唤醒
+  // 在工作线程中调用时只分给当前task_group和空闲的task_group，第一份放入本地队列；
+  // 在非工作线程中调用时放入全局注入队列
+  void push_tasks(TaskMeta* const* tasks, size_t n);
+
+  size_t task_groups_num() const { return task_groups_num_; }
+
+  // inject_task 非工作线程提交任务，放入全局注入队列，必要时唤醒一个空闲的工作线程
+  // 工作线程在本地队列为空时和每SCHED_FAIRNESS_INTERVAL次调度中轮询注入队列
+  void inject_task(TaskMeta* task) {
+    inject_queue_.push(task);
+    signal_task();
+  }
+
+  // inject_tasks 批量提交，一次入队、一次唤醒
+  void inject_tasks(TaskMeta* const* tasks, size_t n) {
+    inject_queue_.push_batch(tasks, n);
+    signal_task();
+  }
+
+  // pop_injected_tasks 取走注入队列中的全部任务，返回值见TaskInjectQueue::pop_all
+  TaskMeta* pop_injected_tasks() { return inject_queue_.pop_all(); }
+
+  // 空闲工作线程登记
+  // 1. 找不到任务的工作线程先自旋（计入nspinning_），自旋失败后登记为空闲并park
+  // 2. 添加任务后调用signal_task，有自旋中的工作线程时不唤醒，否则唤醒一个空闲的工作线程
+  // 3. 被唤醒的工作线程视为自旋中，由唤醒者代为计入nspinning_，避免重复唤醒
+  // 4. 自旋中的工作线程找到任务时，如果是最后一个自旋的，再唤醒一个，任务多时逐个唤醒
+
+  // signal_task 有新的任务可以运行，必要时唤醒一个空闲的工作线程
+  void signal_task();
+
+  // add_spinning 工作线程开始自旋寻找任务
+  void add_spinning() { nspinning_.fetch_add(1, std::memory_order_seq_cst); }
+
+  // sub_spinning 工作线程停止自旋，返回值：是否是最后一个自旋的工作线程
+  bool sub_spinning() {
+    return nspinning_.fetch_sub(1, std::memory_order_seq_cst) == 1;
   }
 
-  ParkingLot* alloc_parking_lot(size_t idx) {
-    return &parking_lots_[idx / ((task_groups_num() + parking_lots_num() - 1) /
-                                 parking_lots_num())];
+  // add_idle 登记task_group为空闲
+  void add_idle(TaskGroup* task_group);
+
+  // take_idle 取出最多n个空闲的task_group，与signal_task一样代为计入nspinning_
+  // 调用方需要把任务交给它们并unpark。返回值：取出的个数
+  size_t take_idle(TaskGroup** task_groups, size_t n);
+
+  // remove_idle 取消task_group的空闲登记，返回值：false表示已经被唤醒者取走
+  bool remove_idle(TaskGroup* task_group);
+
+  size_t idle_num() const { return nidle_.load(std::memory_order_relaxed); }
+
+  // migration_count 所有task_group的迁移次数之和，即协程换到其他工作线程上继续运行的次数
+  size_t migration_count() const;
+
+  // stats 各task_group的调度统计，下标与task_group(i)一致，可以在任意线程调用
+  std::vector<TaskGroupStats> stats() const;
+
+  // total_stats 所有task_group的调度统计之和
+  TaskGroupStats total_stats() const;
+
+  // spare_threads_num 正在运行的临时线程数
+  size_t spare_threads_num() const;
+
+  // handoff_count 启动临时线程接手阻塞的task_group的次数
+  size_t handoff_count() const {
+    return nhandoffs_.load(std::memory_order_relaxed);
   }
 
-  static constexpr size_t task_groups_num() { return TASK_GROUPS_NUM; }
+  // retire_spare 临时线程退出，task_group留给之后的临时线程复用，由run_spare_task调用
+  void retire_spare(TaskGroup* spare);
+
+  // add_blocking 工作线程进入最外层的BlockingScope，监控线程在park时唤醒它
+  void add_blocking() {
+    if (nblocking_.fetch_add(1, std::memory_order_seq_cst) == 0 &&
+        monitor_parked_.load(std::memory_order_seq_cst)) {
+      monitor_parking_lot_.unpark();
+    }
+  }
 
-  static constexpr size_t parking_lots_num() { return PARKING_LOTS_NUM; }
+  // sub_blocking 工作线程退出最外层的BlockingScope
+  void sub_blocking() { nblocking_.fetch_sub(1, std::memory_order_relaxed); }
 
  private:
+  // monitor 监控线程的主函数，每time_slice_ms/4采样一次各工作线程的调度序号
+  // 有工作线程在阻塞调用中时每1ms检查一次，需要时启动临时线程接手；
+  // 没有时不轮询阻塞，park到下一次采样，由add_blocking唤醒；
+  // 所有工作线程都空闲时park到被add_blocking或sub_idle唤醒
+  void monitor();
+
+  // sub_idle 取消n个task_group的空闲登记，调用方持有idle_mu_
+  // 从所有工作线程都空闲变为有工作线程运行时唤醒park的监控线程
+  void sub_idle(size_t n) {
+    if (nidle_.fetch_sub(n, std::memory_order_seq_cst) == task_groups_num_ &&
+        monitor_parked_.load(std::memory_order_seq_cst)) {
+      monitor_parking_lot_.unpark();
+    }
+  }
+
+  // check_time_slice 报告运行超过时间片的协程
+  struct Sample;
+  void check_time_slice(std::vector<Sample>& samples, int64_t now);
+
+  // check_blocking 为阻塞超过blocking_handoff_ms且本地队列还有任务的task_group启动临时线程
+  // 返回值：是否有task_group在阻塞调用中
+  bool check_blocking(int64_t now);
+
+  // start_spare 启动临时线程接手victim，已经有不在阻塞调用中的临时线程接手victim，
+  // 或者临时线程数达到上限时不启动
+  void start_spare(TaskGroup* victim);
+
+  const size_t task_groups_num_;  // the number of task groups
+  const bool bind_cpu_;           // bind worker threads to cpus
+  const int64_t time_slice_ns_;   // 0表示不启动监控线程
+  const size_t offload_max_threads_;
+  const int64_t blocking_handoff_ns_;  // 0表示不接手
+  const size_t spare_max_threads_;
+
   TaskGroup** task_groups_;      // task groups
-  ParkingLot* parking_lots_;     // parking lots
   std::thread* worker_threads_;  // the thread to which the task group belongs
+  std::thread monitor_thread_;   // 监控长时间运行的协程和阻塞的工作线程
 
   std::atomic<size_t> init_success_num_;  // for init task_group
+
+  TaskInjectQueue inject_queue_;  // 非工作线程提交的任务
+
+  alignas(64) std::atomic<size_t> nspinning_;  // 自旋寻找任务的工作线程数
+  alignas(64) std::atomic<size_t> nidle_;      // 空闲的工作线程数
+  utils::SpinMutex idle_mu_;
+  std::vector<TaskGroup*> idle_groups_;  // 空闲的task_group，后进先出
+
+  mutable std::mutex spare_mu_;
+  std::vector<TaskGroup*> spare_groups_;  // 临时线程使用的task_group，不释放
+  std::atomic<size_t> nhandoffs_;
+
+  alignas(64) std::atomic<size_t> nblocking_;  // 在BlockingScope中的task_group数
+  std::atomic<bool> monitor_parked_;  // 监控线程在monitor_parking_lot_中park
+  ParkingLot monitor_parking_lot_;
 };
 
-}  // namespace task_coroutine
\ No newline at end of file
+}  // namespace task_coroutine
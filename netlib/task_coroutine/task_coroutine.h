@@ -2,20 +2,37 @@
 
 #include <assert.h>
 
+#include <chrono>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "task_blocking.h"
+#include "task_callable.h"
+#include "task_channel.h"
 #include "task_control.h"
 #include "task_group.h"
+#include "task_offload.h"
+#include "task_stackless.h"
+#include "task_sync.h"
+#include "task_timer.h"
+#include "task_yield.h"
 
 namespace task_coroutine {
 
 class Coroutine {
  public:
-  Coroutine(void* fn(void*), void* arg) {
-    TaskGroup* tg = g_task_control->choose_one_task_group();
-    task_meta_ = tg->add_task(fn, arg);
+  // attr.stack_type 指定栈大小类别，默认StackType::NORMAL
+  Coroutine(void* fn(void*), void* arg, const TaskAttr& attr = TaskAttr()) {
+    task_meta_ = TaskMeta::new_task(fn, arg, TaskGroup::jump_fn, attr);
     // TODO: 如果创建失败，原地调用，在非main_task中运行有栈溢出风险
     if (task_meta_ == nullptr) {
       fn(arg);
+      return;
     }
+    // 工作线程中创建的任务放入本地队列，由空闲的工作线程窃取；非工作线程放入全局注入队列
+    TaskGroup::start_task(task_meta_);
   }
 
   Coroutine(Coroutine&& c) : task_meta_(c.task_meta_) {
@@ -38,20 +55,118 @@ class Coroutine {
   }
 
   // join 等待coroutine完成
+  // 在协程中调用时park当前协程，coroutine完成时被唤醒一次；在非工作线程中调用时阻塞在futex上
   void join() {
     if (task_meta_ != nullptr) {
-      while ((task_meta_->state.load(std::memory_order_relaxed) &
-              TaskMeta::state_fn_done) == 0) {
-        yield();
-      }
+      TaskGroup::join(task_meta_);
       try_destory();
     }
   }
 
+  // join_for 最多等待d，返回值：false表示超时，coroutine尚未完成，之后可以再次join
+  template <typename Rep, typename Period>
+  bool join_for(const std::chrono::duration<Rep, Period>& d) {
+    return join_until_ns(deadline_ns(d));
+  }
+
+  // join_until 最多等待到tp，返回值同join_for
+  template <typename Clock, typename Duration>
+  bool join_until(const std::chrono::time_point<Clock, Duration>& tp) {
+    return join_until_ns(deadline_ns(tp));
+  }
+
+  // sleep_for 当前coroutine休眠d，不占用工作线程，精度为1ms
+  // 在非工作线程中调用时阻塞当前线程
+  template <typename Rep, typename Period>
+  static void sleep_for(const std::chrono::duration<Rep, Period>& d) {
+    TaskGroup::sleep_until(deadline_ns(d));
+  }
+
+  // sleep_until 当前coroutine休眠到tp
+  template <typename Clock, typename Duration>
+  static void sleep_until(const std::chrono::time_point<Clock, Duration>& tp) {
+    TaskGroup::sleep_until(deadline_ns(tp));
+  }
+
+  // spawn_n 批量创建n个coroutine，第i个运行fn(args[i])，args为nullptr时参数都为nullptr
+  // TaskMeta批量分配，分成若干份放入不同的task_group，每份只入队、唤醒一次
+  static std::vector<Coroutine> spawn_n(size_t n, void* fn(void*),
+                                        void* const* args = nullptr,
+                                        const TaskAttr& attr = TaskAttr()) {
+    std::vector<TaskMeta*> tasks(n);
+    size_t created = TaskMeta::new_tasks(fn, args, n, TaskGroup::jump_fn,
+                                         attr, tasks.data());
+    TaskControl::get()->push_tasks(tasks.data(), created);
+    std::vector<Coroutine> cs;
+    cs.reserve(n);
+    for (size_t i = 0; i < created; ++i) {
+      cs.push_back(Coroutine(tasks[i]));
+    }
+    // 创建失败的部分原地调用，与单个创建时一致
+    for (size_t i = created; i < n; ++i) {
+      fn(args != nullptr ? args[i] : nullptr);
+      cs.push_back(Coroutine(nullptr));
+    }
+    return cs;
+  }
+
+  // spawn 为[first, last)中的每个可调用对象创建一个coroutine，无参数调用可调用对象的拷贝
+  // 拷贝构造在各自协程的栈顶，不额外分配内存，返回值被丢弃
+  template <typename ForwardIterator>
+  static std::vector<Coroutine> spawn(ForwardIterator first,
+                                      ForwardIterator last,
+                                      const TaskAttr& attr = TaskAttr()) {
+    using F = typename std::decay<decltype(*first)>::type;
+    using C = TaskCallable<F, void>;
+    size_t n = static_cast<size_t>(std::distance(first, last));
+    std::vector<TaskMeta*> tasks(n);
+    size_t created = TaskMeta::new_tasks(C::run, nullptr, n, TaskGroup::jump_fn,
+                                         attr, tasks.data(), sizeof(C));
+    for (size_t i = 0; i < created; ++i, ++first) {
+      C::emplace(tasks[i], *first);
+    }
+    TaskControl::get()->push_tasks(tasks.data(), created);
+    std::vector<Coroutine> cs;
+    cs.reserve(n);
+    for (size_t i = 0; i < created; ++i) {
+      cs.push_back(Coroutine(tasks[i]));
+    }
+    for (; first != last; ++first) {
+      F f(*first);
+      f();
+      cs.push_back(Coroutine(nullptr));
+    }
+    return cs;
+  }
+
   // yield 换出当前coroutine
   static void yield() { TaskGroup::reschedule(); }
 
+  // should_yield 当前coroutine是否运行超过了时间片（TaskControlOptions::time_slice_ms）
+  // 长时间计算的循环可以定期检查，返回true时调用yield
+  static bool should_yield() { return TaskGroup::should_yield(); }
+
+  // maybe_yield should_yield时yield
+  static void maybe_yield() { TaskGroup::maybe_yield(); }
+
  private:
+  template <typename R>
+  friend class JoinHandle;
+  friend class TaskScope;
+
+  explicit Coroutine(TaskMeta* task_meta) : task_meta_(task_meta) {}
+
+  bool join_until_ns(int64_t deadline_ns) {
+    if (task_meta_ == nullptr) {
+      return true;
+    }
+    if (!TaskGroup::join_until(task_meta_, deadline_ns)) {
+      return false;
+    }
+    try_destory();
+    return true;
+  }
+
   // try_destory 尝试销毁task_meta，修改task_meta的状态，在join和dtor时调用
   void try_destory() {
     // TODO: 添加memory_order
@@ -65,4 +180,75 @@ class Coroutine {
   TaskMeta* task_meta_;
 };
 
-}  // namespace task_coroutine
\ No newline at end of file
+template <typename R>
+class JoinHandle;
+
+template <typename F>
+JoinHandle<TaskCallableResult<F>> spawn(F&& f,
+                                        const TaskAttr& attr = TaskAttr());
+
+// JoinHandle spawn返回的协程句柄，join时取出可调用对象的返回值
+// 与Coroutine一样，析构时不等待协程完成
+template <typename R>
+class JoinHandle {
+ public:
+  JoinHandle(JoinHandle&&) = default;
+  JoinHandle& operator=(JoinHandle&&) = default;
+
+  // valid 协程是否创建成功，内存不足时spawn返回无效的JoinHandle，不能join
+  bool valid() const { return co_.task_meta_ != nullptr; }
+
+  // join 等待协程完成并返回可调用对象的返回值，只能调用一次
+  R join() {
+    TaskMeta* task = co_.task_meta_;
+    assert(task != nullptr);
+    TaskGroup::join(task);
+    if constexpr (std::is_void<R>::value) {
+      co_.try_destory();
+    } else {
+      // 返回值保存在task的栈顶，移出后再释放task
+      R r = std::move(*static_cast<TaskResult<R>*>(task->arg)->value);
+      co_.try_destory();
+      return r;
+    }
+  }
+
+ private:
+  template <typename F>
+  friend JoinHandle<TaskCallableResult<F>> spawn(F&& f, const TaskAttr& attr);
+
+  explicit JoinHandle(TaskMeta* task) : co_(task) {}
+
+  Coroutine co_;
+};
+
+// new_callable_task 创建运行可调用对象F的任务，以args在栈顶构造F，R为返回值类型，还没有入队
+// 内存不足时返回nullptr，不使用args（不会被移动）。spawn和TaskScope::spawn共用
+template <typename F, typename R, typename... Args>
+TaskMeta* new_callable_task(const TaskAttr& attr, Args&&... args) {
+  using C = TaskCallable<F, R>;
+  TaskMeta* task = TaskMeta::new_task(C::run, nullptr, TaskGroup::jump_fn,
+                                      attr, sizeof(C));
+  if (task != nullptr) {
+    C::emplace(task, std::forward<Args>(args)...);
+  }
+  return task;
+}
+
+// spawn 创建运行可调用对象f的协程，f可以带捕获、只能移动
+// f移动/拷贝构造在协程的栈顶，不额外分配内存，返回值在join时取出
+// 内存不足时返回无效的JoinHandle（valid()为false），f没有被移动，由调用者决定如何处理
+// 例：auto h = spawn([x]() { return x * 2; }); int r = h.join();
+template <typename F>
+JoinHandle<TaskCallableResult<F>> spawn(F&& f, const TaskAttr& attr) {
+  TaskMeta* task =
+      new_callable_task<typename std::decay<F>::type, TaskCallableResult<F>>(
+          attr, std::forward<F>(f));
+  if (task == nullptr) {
+    return JoinHandle<TaskCallableResult<F>>(nullptr);
+  }
+  TaskGroup::start_task(task);
+  return JoinHandle<TaskCallableResult<F>>(task);
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace task_coroutine {
+
+// futex_wait addr的值等于expected时阻塞，直到被futex_wake唤醒、超时或被信号中断
+// timeout为相对时间，nullptr表示不超时
+inline int futex_wait(std::atomic<uint32_t>* addr, uint32_t expected,
+                      const struct timespec* timeout = nullptr) {
+  return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+                                  FUTEX_WAIT_PRIVATE, expected, timeout,
+                                  nullptr, 0));
+}
+
+// futex_wake 唤醒最多n个阻塞在addr上的线程
+inline int futex_wake(std::atomic<uint32_t>* addr, int n) {
+  return static_cast<int>(syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+                                  FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0));
+}
+
+// cpu_relax 自旋等待时降低CPU消耗
+inline void cpu_relax() { __builtin_ia32_pause(); }
+
+}  // namespace task_coroutine
@@ -0,0 +1,90 @@
+#include "task_future.h"
+
+#include "task_group.h"
+
+namespace task_coroutine {
+
+FutureStateBase::~FutureStateBase() {
+  // 未就绪时析构说明没有关联的Promise了，回调不会再被调用
+  while (FutureCallback* cb = callbacks_) {
+    callbacks_ = cb->next;
+    delete cb;
+  }
+}
+
+void FutureStateBase::wait() {
+  if (ready()) {
+    return;
+  }
+  mu_.lock();
+  if (ready()) {
+    mu_.unlock();
+    return;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  TaskGroup::wait_unlock(&w, &mu_);
+}
+
+bool FutureStateBase::wait_until(int64_t deadline_ns) {
+  if (ready()) {
+    return true;
+  }
+  mu_.lock();
+  if (ready()) {
+    mu_.unlock();
+    return true;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  return TaskGroup::wait_unlock_until(&w, &mu_, &waiters_, deadline_ns);
+}
+
+void FutureStateBase::make_ready() {
+  WaiterList<TaskWaiter> waiters;
+  FutureCallback* callbacks;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    assert(!ready());
+    ready_.store(true, std::memory_order_release);
+    while (TaskWaiter* w = waiters_.pop_front()) {
+      waiters.push_back(w);
+    }
+    callbacks = callbacks_;
+    callbacks_ = nullptr;
+  }
+  while (TaskWaiter* w = waiters.pop_front()) {
+    TaskGroup::wake(w);
+  }
+  // 按注册顺序调用
+  FutureCallback* reversed = nullptr;
+  while (callbacks != nullptr) {
+    FutureCallback* next = callbacks->next;
+    callbacks->next = reversed;
+    reversed = callbacks;
+    callbacks = next;
+  }
+  while (reversed != nullptr) {
+    FutureCallback* next = reversed->next;
+    reversed->run();
+    delete reversed;
+    reversed = next;
+  }
+}
+
+void FutureStateBase::add_callback(FutureCallback* cb) {
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    if (!ready()) {
+      cb->next = callbacks_;
+      callbacks_ = cb;
+      return;
+    }
+  }
+  cb->run();
+  delete cb;
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "task_coroutine.h"
+#include "task_timer.h"
+#include "task_waiter.h"
+#include "utils/spin_mutex.h"
+
+namespace task_coroutine {
+
+// Future/Promise
+// 1. Promise设置值，Future等待并读取值，二者共享状态，Future可以拷贝
+// 2. 在协程中等待时park当前协程，在非工作线程中等待时阻塞在futex上
+// 3. then在就绪后创建协程运行后续任务；when_all/when_any组合多个Future
+// 4. Promise未设置值就析构时Future也会就绪，但has_value()为false（broken promise）
+
+// FutureCallback 就绪时调用的回调，侵入式单链表
+struct FutureCallback {
+  FutureCallback* next = nullptr;
+
+  virtual ~FutureCallback() {}
+
+  virtual void run() = 0;
+};
+
+template <typename G>
+struct FutureCallbackImpl : FutureCallback {
+  explicit FutureCallbackImpl(G&& g_) : g(std::move(g_)) {}
+
+  void run() override { g(); }
+
+  G g;
+};
+
+// FutureStateBase 共享状态中与值类型无关的部分：就绪标记、等待者和回调
+class FutureStateBase {
+ public:
+  FutureStateBase() : ready_(false), callbacks_(nullptr) {}
+
+  FutureStateBase(const FutureStateBase&) = delete;
+  FutureStateBase& operator=(const FutureStateBase&) = delete;
+
+  ~FutureStateBase();
+
+  bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+  void wait();
+
+  // wait_until deadline_ns为monotonic_ns，返回值：是否就绪
+  bool wait_until(int64_t deadline_ns);
+
+  // on_ready 注册就绪时调用的回调，已经就绪时在当前线程立即调用
+  // 回调在设置值的协程/线程中调用，不能阻塞
+  template <typename G>
+  void on_ready(G&& g) {
+    FutureCallback* cb = new (std::nothrow)
+        FutureCallbackImpl<typename std::decay<G>::type>(std::forward<G>(g));
+    assert(cb != nullptr);
+    add_callback(cb);
+  }
+
+ protected:
+  // make_ready 设置为就绪，唤醒所有等待者并调用回调，只能调用一次
+  void make_ready();
+
+ private:
+  void add_callback(FutureCallback* cb);
+
+  utils::SpinMutex mu_;
+  std::atomic<bool> ready_;
+  WaiterList<TaskWaiter> waiters_;
+  FutureCallback* callbacks_;  // 后进先出，调用时反转为注册顺序
+};
+
+// FutureVoid Future<void>内部保存的值
+struct FutureVoid {};
+
+template <typename T>
+struct FutureTraits {
+  using value_type = T;
+  using get_type = const T&;
+};
+
+template <>
+struct FutureTraits<void> {
+  using value_type = FutureVoid;
+  using get_type = void;
+};
+
+template <typename T>
+class FutureState : public FutureStateBase {
+ public:
+  using value_type = typename FutureTraits<T>::value_type;
+
+  template <typename... Args>
+  void set_value(Args&&... args) {
+    assert(!ready());
+    value_.emplace(std::forward<Args>(args)...);
+    make_ready();
+  }
+
+  void set_broken() {
+    assert(!ready());
+    make_ready();
+  }
+
+  // value 就绪后访问
+  std::optional<value_type>& value() { return value_; }
+
+ private:
+  std::optional<value_type> value_;
+};
+
+template <typename T>
+class Promise;
+
+// FutureThenResult 后续任务f的返回值类型，f的参数为const T&（T为void时没有参数）
+template <typename F, typename T>
+struct FutureThenResultImpl {
+  using type = typename std::decay<std::invoke_result_t<F&, const T&>>::type;
+};
+
+template <typename F>
+struct FutureThenResultImpl<F, void> {
+  using type = typename std::decay<std::invoke_result_t<F&>>::type;
+};
+
+template <typename F, typename T>
+using FutureThenResult =
+    typename FutureThenResultImpl<typename std::decay<F>::type, T>::type;
+
+template <typename T>
+class Future {
+ public:
+  Future() {}
+
+  // valid 是否关联了Promise
+  bool valid() const { return state_ != nullptr; }
+
+  bool ready() const { return state_->ready(); }
+
+  // has_value 就绪且设置了值，Promise未设置值就析构时为false
+  bool has_value() const { return ready() && state_->value().has_value(); }
+
+  // wait 等待就绪
+  void wait() const { state_->wait(); }
+
+  // wait_for 最多等待d，返回值：是否就绪
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& d) const {
+    return state_->wait_until(deadline_ns(d));
+  }
+
+  template <typename Clock, typename Duration>
+  bool wait_until(const std::chrono::time_point<Clock, Duration>& tp) const {
+    return state_->wait_until(deadline_ns(tp));
+  }
+
+  // get 等待就绪并返回值，需要has_value()
+  typename FutureTraits<T>::get_type get() const {
+    state_->wait();
+    assert(state_->value().has_value());
+    if constexpr (!std::is_void<T>::value) {
+      return *state_->value();
+    }
+  }
+
+  // then 就绪后创建协程运行f(get())（T为void时为f()），返回f的返回值的Future
+  // 没有值（broken promise）或内存不足无法创建协程时不运行f，返回的Future同样没有值
+  template <typename F>
+  Future<FutureThenResult<F, T>> then(F&& f,
+                                      const TaskAttr& attr = TaskAttr()) const {
+    using U = FutureThenResult<F, T>;
+    Promise<U> promise;
+    Future<U> future = promise.get_future();
+    std::shared_ptr<FutureState<T>> state = state_;
+    state_->on_ready([state, promise = std::move(promise),
+                      f = typename std::decay<F>::type(std::forward<F>(f)),
+                      attr]() mutable {
+      if (!state->value().has_value()) {
+        return;  // promise析构，返回的Future没有值
+      }
+      spawn(
+          [state = std::move(state), promise = std::move(promise),
+           f = std::move(f)]() mutable {
+            if constexpr (std::is_void<U>::value) {
+              if constexpr (std::is_void<T>::value) {
+                f();
+              } else {
+                f(*state->value());
+              }
+              promise.set_value();
+            } else {
+              if constexpr (std::is_void<T>::value) {
+                promise.set_value(f());
+              } else {
+                promise.set_value(f(*state->value()));
+              }
+            }
+          },
+          attr);
+    });
+    return future;
+  }
+
+  // on_ready 就绪时调用f()，在设置值的协程/线程中调用，不能阻塞
+  template <typename F>
+  void on_ready(F&& f) const {
+    state_->on_ready(std::forward<F>(f));
+  }
+
+ private:
+  friend class Promise<T>;
+
+  explicit Future(std::shared_ptr<FutureState<T>> state)
+      : state_(std::move(state)) {}
+
+  std::shared_ptr<FutureState<T>> state_;
+};
+
+template <typename T>
+class Promise {
+ public:
+  Promise() : state_(std::make_shared<FutureState<T>>()) {}
+
+  Promise(Promise&& rhs) = default;
+
+  Promise& operator=(Promise&& rhs) {
+    if (this != &rhs) {
+      break_promise();
+      state_ = std::move(rhs.state_);
+    }
+    return *this;
+  }
+
+  Promise(const Promise&) = delete;
+  Promise& operator=(const Promise&) = delete;
+
+  ~Promise() { break_promise(); }
+
+  Future<T> get_future() const { return Future<T>(state_); }
+
+  // set_value 设置值，唤醒等待者，只能调用一次
+  template <typename... Args>
+  void set_value(Args&&... args) {
+    state_->set_value(std::forward<Args>(args)...);
+  }
+
+ private:
+  // break_promise 没有设置值就析构时，Future就绪但没有值
+  void break_promise() {
+    if (state_ != nullptr && !state_->ready()) {
+      state_->set_broken();
+    }
+  }
+
+  std::shared_ptr<FutureState<T>> state_;
+};
+
+// async 创建协程运行f()，返回其返回值的Future，内存不足无法创建协程时Future没有值
+template <typename F>
+Future<TaskCallableResult<F>> async(F&& f, const TaskAttr& attr = TaskAttr()) {
+  using R = TaskCallableResult<F>;
+  Promise<R> promise;
+  Future<R> future = promise.get_future();
+  spawn(
+      [promise = std::move(promise),
+       f = typename std::decay<F>::type(std::forward<F>(f))]() mutable {
+        if constexpr (std::is_void<R>::value) {
+          f();
+          promise.set_value();
+        } else {
+          promise.set_value(f());
+        }
+      },
+      attr);
+  return future;
+}
+
+// when_all 所有Future就绪后就绪，值为按顺序排列的各个值（T为void时没有值）
+// 任意一个没有值时，返回的Future也没有值
+template <typename T>
+Future<typename std::conditional<std::is_void<T>::value, void,
+                                 std::vector<T>>::type>
+when_all(const std::vector<Future<T>>& futures) {
+  using R = typename std::conditional<std::is_void<T>::value, void,
+                                      std::vector<T>>::type;
+  struct Context {
+    std::atomic<size_t> remaining;
+    Promise<R> promise;
+    std::vector<Future<T>> futures;
+  };
+  auto ctx = std::make_shared<Context>();
+  ctx->remaining.store(futures.size(), std::memory_order_relaxed);
+  ctx->futures = futures;
+  Future<R> future = ctx->promise.get_future();
+  auto complete = [](Context* ctx) {
+    for (auto& f : ctx->futures) {
+      if (!f.has_value()) {
+        return;  // ctx析构时promise析构，返回的Future没有值
+      }
+    }
+    if constexpr (std::is_void<T>::value) {
+      ctx->promise.set_value();
+    } else {
+      std::vector<T> values;
+      values.reserve(ctx->futures.size());
+      for (auto& f : ctx->futures) {
+        values.push_back(f.get());
+      }
+      ctx->promise.set_value(std::move(values));
+    }
+  };
+  if (futures.empty()) {
+    complete(ctx.get());
+    return future;
+  }
+  for (auto& f : futures) {
+    f.on_ready([ctx, complete]() {
+      if (ctx->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        complete(ctx.get());
+        ctx->futures.clear();
+      }
+    });
+  }
+  return future;
+}
+
+// when_any 最先就绪的k个Future就绪后就绪，值为它们在futures中的下标，按就绪顺序排列
+// k大于futures的个数时等待全部就绪。用于扇出N个子任务、前K个完成即返回的场景，
+// 配合wait_for实现超时
+template <typename T>
+Future<std::vector<size_t>> when_any(const std::vector<Future<T>>& futures,
+                                     size_t k = 1) {
+  struct Context {
+    utils::SpinMutex mu;
+    size_t k;
+    std::vector<size_t> indexes;
+    Promise<std::vector<size_t>> promise;
+  };
+  auto ctx = std::make_shared<Context>();
+  ctx->k = std::min(k, futures.size());
+  ctx->indexes.reserve(ctx->k);
+  Future<std::vector<size_t>> future = ctx->promise.get_future();
+  if (ctx->k == 0) {
+    ctx->promise.set_value();
+    return future;
+  }
+  for (size_t i = 0; i < futures.size(); ++i) {
+    futures[i].on_ready([ctx, i]() {
+      std::vector<size_t> indexes;
+      {
+        std::lock_guard<utils::SpinMutex> lock(ctx->mu);
+        if (ctx->indexes.size() == ctx->k) {
+          return;
+        }
+        ctx->indexes.push_back(i);
+        if (ctx->indexes.size() < ctx->k) {
+          return;
+        }
+        indexes = ctx->indexes;
+      }
+      ctx->promise.set_value(std::move(indexes));
+    });
+  }
+  return future;
+}
+
+}  // namespace task_coroutine
@@ -1,25 +1,53 @@
 #include "task_group.h"
 
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <mutex>
 #include <thread>
+#include <utility>
 
 #include "task_context.h"
 #include "task_control.h"
+#include "task_stackless.h"
 
 namespace task_coroutine {
 
 thread_local TaskGroup* tls_task_group = nullptr;
 
-TaskGroup::TaskGroup(TaskControl* task_control, ParkingLot* parking_lot)
-    : task_control_(task_control),
-      parking_lot_(parking_lot),
+static struct sigaction g_old_segv_action;  // 安装前的SIGSEGV处理方式
+
+TaskGroup::TaskGroup(TaskControl* task_control, bool spare)
+    : runnext_(nullptr),
+      credits_{PRIORITY_WEIGHTS[0], PRIORITY_WEIGHTS[1], PRIORITY_WEIGHTS[2]},
+      sched_tick_(SCHED_FAIRNESS_INTERVAL),
+      tick_inject_(false),
+      runnext_streak_(0),
+      task_control_(task_control),
+      spinning_(false),
+      spin_rounds_(MIN_SPIN_ROUNDS),
       main_task_(TaskMeta::main_task()),
       curr_task_(main_task_),
       done_task_(nullptr),
-      yield_task_(nullptr) {
+      remained_fn_(nullptr),
+      remained_arg_(nullptr),
+      stackless_task_(nullptr),
+      in_stackless_(false),
+      running_task_(nullptr),
+      running_file_(nullptr),
+      running_line_(0),
+      should_yield_(false),
+      blocking_since_ns_(0),
+      blocking_depth_(0),
+      spare_(spare),
+      handoff_from_(nullptr),
+      retiring_(false),
+      signal_stack_(nullptr),
+      start_ns_(monotonic_ns()) {
   assert(task_control != nullptr);
   assert(main_task_ != nullptr);
 }
@@ -29,49 +57,592 @@ TaskGroup::TaskGroup(TaskControl* task_control, ParkingLot* parking_lot)
 // 这时恰好co2被tg2执行掉了且所有tg的sq都空，tg1就会陷入wait_task的死循环
 // 目前解决方案：
 // Coroutine::yield -> TaskGroup::reschedule -> 切换回main_task_ ->
-// 回到主循环，在主循环中把yield_task_入队（随机）
+// 回到主循环，在主循环中把yield的task放入本地remote_rq_
 void TaskGroup::wait_task(TaskMeta** task) {
-again:
-  if (sq_.try_pop(*task)) {
+  if (spare_) {
+    if (!wait_spare_task(task)) {
+      retiring_ = true;
+      *task = main_task_;
+    }
+    return;
+  }
+  run_timers();
+  if (pop_local_task(task)) {
     return;
   }
-  for (size_t i = 0; i < task_control_->task_groups_num(); ++i) {
-    if (task_control_->choose_one_task_group()->sq_.try_pop(*task)) {
+  if (!spinning_) {
+    spinning_ = true;
+    task_control_->add_spinning();
+  }
+  running_task_.store(nullptr, std::memory_order_relaxed);
+  int64_t idle_begin = monotonic_ns();
+  for (;;) {
+    // 1. 自旋寻找任务
+    for (size_t i = 0; i < spin_rounds_; ++i) {
+      // 最后一轮才窃取runnext_，它的所属工作线程通常很快就会运行它
+      if (find_task(task, i + 1 == spin_rounds_)) {
+        spin_rounds_ = std::min(spin_rounds_ * 2, MAX_SPIN_ROUNDS);
+        stop_spinning();
+        idle_ns_.add(monotonic_ns() - idle_begin);
+        return;
+      }
+      for (size_t j = 0; j < 16; ++j) {
+        cpu_relax();
+      }
+    }
+    spin_rounds_ = std::max(spin_rounds_ / 2, MIN_SPIN_ROUNDS);
+
+    // 2. 登记为空闲，停止自旋后再检查一次，避免与signal_task之间丢失唤醒
+    task_control_->add_idle(this);
+    spinning_ = false;
+    bool last_spinning = task_control_->sub_spinning();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (find_task(task, true)) {
+      if (!task_control_->remove_idle(this)) {
+        // 已经被signal_task取走，消耗它的unpark，并接管它代为计入的nspinning_
+        parking_lot_.park();
+        spinning_ = true;
+        stop_spinning();
+      } else if (last_spinning) {
+        task_control_->signal_task();
+      }
+      idle_ns_.add(monotonic_ns() - idle_begin);
       return;
     }
+
+    // 3. park，被唤醒时唤醒者已代为计入nspinning_
+    //    有定时任务时park到超时，自行取消空闲登记并重新计入nspinning_
+    nparks_.add();
+    if (timer_wheel_.empty()) {
+      parking_lot_.park();
+      nunparks_.add();
+    } else if (parking_lot_.park_until(timer_wheel_.next_timeout_ns())) {
+      nunparks_.add();
+    } else if (task_control_->remove_idle(this)) {
+      task_control_->add_spinning();
+    } else {
+      parking_lot_.park();  // 已经被signal_task取走，消耗它的unpark
+      nunparks_.add();
+    }
+    spinning_ = true;
   }
-#ifdef USE_PARKING_LOT
-  parking_lot_->wait();
-#else
-  std::this_thread::sleep_for(std::chrono::microseconds(1));
-#endif
-  goto again;
+}
+
+bool TaskGroup::wait_spare_task(TaskMeta** task) {
+  running_task_.store(nullptr, std::memory_order_relaxed);
+  int64_t idle_begin = monotonic_ns();
+  for (;;) {
+    run_timers();
+    if (pop_weighted_task(task)) {
+      break;
+    }
+    if (handoff_from_->blocking_since_ns() != 0) {
+      nsteal_attempts_.add();
+      if (steal_task(handoff_from_, task, true)) {
+        nsteals_.add();
+        break;
+      }
+      if (pop_inject_task(task)) {
+        break;
+      }
+    } else if (!timer_wheel_.has_pending()) {
+      return false;  // 接手的task_group已经返回，剩余的任务由它自己运行
+    }
+    // 只剩已取消的定时任务时不等待它们的到期时间，留在时间轮中，复用这个task_group时移除
+    int64_t now = monotonic_ns();
+    if (!timer_wheel_.has_pending()) {
+      if (now - idle_begin >= SPARE_IDLE_NS) {
+        return false;
+      }
+      parking_lot_.park_until(now + SPARE_POLL_NS);
+    } else {
+      parking_lot_.park_until(
+          std::min(now + SPARE_POLL_NS, timer_wheel_.next_timeout_ns()));
+    }
+  }
+  idle_ns_.add(monotonic_ns() - idle_begin);
+  return true;
+}
+
+void TaskGroup::stop_spinning() {
+  spinning_ = false;
+  if (task_control_->sub_spinning()) {
+    task_control_->signal_task();
+  }
+}
+
+bool TaskGroup::pop_local_task(TaskMeta** task) {
+  if (--sched_tick_ == 0) {
+    sched_tick_ = SCHED_FAIRNESS_INTERVAL;
+    tick_inject_ = !tick_inject_;
+    queue_depth_max_.update_max(queue_depth());
+    if (tick_inject_ ? pop_inject_task(task) : pop_remote_task(task)) {
+      runnext_streak_ = 0;
+      return true;
+    }
+  }
+  if (runnext_.load(std::memory_order_relaxed) != nullptr) {
+    TaskMeta* t = runnext_.exchange(nullptr, std::memory_order_acquire);
+    if (t != nullptr) {
+      if (++runnext_streak_ <= MAX_RUNNEXT_STREAK) {
+        *task = t;
+        return true;
+      }
+      remote_rq_[priority_index(t)].push(t);
+    }
+  }
+  runnext_streak_ = 0;
+  return pop_weighted_task(task) || pop_inject_task(task);
+}
+
+bool TaskGroup::pop_weighted_task(TaskMeta** task) {
+  for (size_t i = 0; i < TASK_PRIORITY_NUM; ++i) {
+    if (credits_[i] > 0 && pop_priority_task(i, task)) {
+      --credits_[i];
+      return true;
+    }
+  }
+  // 还有配额的优先级都没有任务，用完配额的优先级有任务时开始新的一轮
+  for (size_t i = 0; i < TASK_PRIORITY_NUM; ++i) {
+    if (credits_[i] == 0 && pop_priority_task(i, task)) {
+      for (size_t j = 0; j < TASK_PRIORITY_NUM; ++j) {
+        credits_[j] = PRIORITY_WEIGHTS[j];
+      }
+      --credits_[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskGroup::pop_remote_task(TaskMeta** task) {
+  for (size_t i = 0; i < TASK_PRIORITY_NUM; ++i) {
+    if (remote_rq_[i].try_pop(*task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TaskGroup::pop_inject_task(TaskMeta** task) {
+  TaskMeta* t = task_control_->pop_injected_tasks();
+  if (t == nullptr) {
+    return false;
+  }
+  bool more = t->next != nullptr;
+  // 链表为后进先出的顺序，依次放入后进先出的rq_，先入队的任务先运行
+  while (t->next != nullptr) {
+    TaskMeta* next = t->next;
+    t->next = nullptr;
+    push_local_task(t);
+    t = next;
+  }
+  *task = t;
+  if (more) {
+    task_control_->signal_task();
+  }
+  return true;
+}
+
+bool TaskGroup::find_task(TaskMeta** task, bool steal_runnext) {
+  run_timers();
+  if (pop_local_task(task)) {
+    return true;
+  }
+  size_t n = task_control_->task_groups_num();
+  size_t start = tls_random_number.generate() % n;
+  for (size_t i = 0; i < n; ++i) {
+    TaskGroup* victim = task_control_->task_group((start + i) % n);
+    if (victim == this) {
+      continue;
+    }
+    nsteal_attempts_.add();
+    if (steal_task(victim, task, steal_runnext)) {
+      nsteals_.add();
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t TaskGroup::queue_depth() const {
+  size_t n = 0;
+  for (size_t i = 0; i < TASK_PRIORITY_NUM; ++i) {
+    n += rq_[i].volatile_size() + remote_rq_[i].size();
+  }
+  return n;
+}
+
+TaskGroupStats TaskGroup::stats() const {
+  TaskGroupStats s;
+  s.tasks_run = ntasks_run_.get();
+  s.context_switches = ncontext_switches_.get();
+  s.stackless_run = nstackless_run_.get();
+  s.migrations = nmigrations_.get();
+  s.steal_attempts = nsteal_attempts_.get();
+  s.steals = nsteals_.get();
+  s.parks = nparks_.get();
+  s.unparks = nunparks_.get();
+  s.queue_depth_max = queue_depth_max_.get();
+  s.idle_ns = static_cast<int64_t>(idle_ns_.get());
+  s.running_ns = std::max<int64_t>(monotonic_ns() - start_ns_ - s.idle_ns, 0);
+  return s;
+}
+
+void TaskGroup::push_task(TaskMeta* task) {
+  if (tls_task_group == this) {
+    push_local_task(task);
+  } else {
+    remote_rq_[priority_index(task)].push(task);
+  }
+  task_control_->signal_task();
+}
+
+void TaskGroup::push_tasks(TaskMeta* const* tasks, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  size_t p = priority_index(tasks[0]);
+  size_t i = 0;
+  if (tls_task_group == this) {
+    while (i < n && rq_[p].push(tasks[i])) {
+      ++i;
+    }
+  }
+  remote_rq_[p].push_batch(tasks + i, n - i);
+  task_control_->signal_task();
+}
+
+void TaskGroup::push_runnext_task(TaskMeta* task) {
+  assert(tls_task_group == this);
+  if (task->priority == TaskPriority::BATCH) {
+    push_local_task(task);
+    task_control_->signal_task();
+    return;
+  }
+  TaskMeta* old = runnext_.exchange(task, std::memory_order_acq_rel);
+  if (old != nullptr) {
+    push_local_task(old);
+  }
+  task_control_->signal_task();
+}
+
+void TaskGroup::start_task(TaskMeta* task) {
+  TaskGroup* g = tls_task_group;
+  if (g != nullptr && !g->spare_) {
+    g->push_task(task);
+  } else {
+    TaskControl::get()->inject_task(task);
+  }
+}
+
+bool TaskGroup::steal_task(TaskGroup* victim, TaskMeta** task,
+                           bool steal_runnext) {
+  // 按优先级从高到低窃取
+  for (size_t i = 0; i < TASK_PRIORITY_NUM; ++i) {
+    if (!victim->rq_[i].steal(*task)) {
+      continue;
+    }
+    // steal half: 逐个CAS窃取，避免批量移动top_时与owner的pop冲突
+    size_t n = victim->rq_[i].volatile_size() / 2;
+    TaskMeta* t;
+    for (size_t j = 0; j < n && victim->rq_[i].steal(t); ++j) {
+      if (!rq_[i].push(t)) {
+        remote_rq_[i].push(t);
+        break;
+      }
+    }
+    return true;
+  }
+  if (victim->pop_remote_task(task)) {
+    return true;
+  }
+  if (!steal_runnext) {
+    return false;
+  }
+  TaskMeta* t = victim->runnext_.load(std::memory_order_relaxed);
+  if (t == nullptr || !victim->runnext_.compare_exchange_strong(
+                          t, nullptr, std::memory_order_acquire)) {
+    return false;
+  }
+  *task = t;
+  return true;
 }
 
 void TaskGroup::reschedule() {
+  if (tls_task_group == nullptr) {  // if `tls_task_group` is nullptr,
+                                    // indicating that it isn't a worker
+                                    // thread (eg. the main thread isn't a
+                                    // worker thread.)
+    return;
+  }
+  if (tls_task_group->curr_task_ == tls_task_group->main_task_) {
+    return;  // 无栈任务在主函数栈上运行，没有可以换出的协程
+  }
+  park(
+      [](void* task) -> void {
+        // 放入本地先进先出的remote_rq_，保持在当前工作线程上，空闲的工作线程可以窃取；
+        // 放入后进先出的rq_会被立刻pop出来，其他task无法运行。正在运行不需要signal_task
+        TaskMeta* t = static_cast<TaskMeta*>(task);
+#ifdef TASK_COROUTINE_REGISTRY
+        t->record.state.store(TaskRunState::READY, std::memory_order_relaxed);
+#endif
+        tls_task_group->remote_rq_[priority_index(t)].push(t);
+      },
+      tls_task_group->curr_task_);
+}
+
+void TaskGroup::maybe_yield() {
+  if (should_yield() && tls_task_group->curr_task_ != tls_task_group->main_task_) {
+    reschedule();
+  }
+}
+
+void* TaskGroup::enter_blocking() {
   TaskGroup* g = tls_task_group;
-  if (g == nullptr) {  // if `tls_task_group` is nullptr, indicating that it
-                       // isn't a worker thread (eg. the main thread isn't a
-                       // worker thread.)
+  if (g == nullptr || (g->curr_task_ == g->main_task_ && !g->in_stackless_)) {
+    return nullptr;
+  }
+  if (g->blocking_depth_++ == 0) {
+    g->blocking_since_ns_.store(monotonic_ns(), std::memory_order_relaxed);
+    g->task_control_->add_blocking();
+  }
+  return g;
+}
+
+void TaskGroup::exit_blocking(void* task_group) {
+  TaskGroup* g = static_cast<TaskGroup*>(task_group);
+  if (g == nullptr) {
     return;
   }
-  g->yield_task_ = g->curr_task_;
+  assert(g == tls_task_group);  // BlockingScope内不能换出协程
+  if (--g->blocking_depth_ == 0) {
+    g->blocking_since_ns_.store(0, std::memory_order_relaxed);
+    g->task_control_->sub_blocking();
+  }
+}
+
+void TaskGroup::park(void (*remained)(void*), void* arg) {
+  TaskGroup* g = tls_task_group;
+  assert(g != nullptr);
+  TaskMeta* curr_task = g->curr_task_;
+  if (curr_task == g->main_task_) {
+    // 等待原语在无栈任务中走futex路径，到这里说明绕过current_task直接调用了park
+    fprintf(stderr, "task_coroutine: park in main task or stackless task\n");
+    abort();
+  }
+  if (curr_task->stack_type == StackType::COMPACT) {
+    curr_task->stack_trimmed =
+        trim_stack(curr_task->memory, curr_task->stack_type,
+                   __builtin_frame_address(0), curr_task->stack_trimmed);
+  }
+#ifdef TASK_COROUTINE_REGISTRY
+  curr_task->record.state.store(TaskRunState::SUSPENDED,
+                                std::memory_order_relaxed);
+#endif
+  g->remained_fn_ = remained;
+  g->remained_arg_ = arg;
   g->curr_task_ = g->main_task_;
 #ifdef TASK_COROUTINE_DEBUG
-  sched_to(g->yield_task_, g->curr_task_, "reschedule");
+  sched_to(curr_task, g->curr_task_, "park");
 #else
-  sched_to(g->yield_task_, g->curr_task_);
+  sched_to(curr_task, g->curr_task_);
 #endif
   g = tls_task_group;  // 重新被调度，task_group可能变化
   g->try_destory_done_task();
 }
 
+void TaskGroup::ready_to_run(TaskMeta* task) {
+#ifdef TASK_COROUTINE_REGISTRY
+  task->record.state.store(TaskRunState::READY, std::memory_order_relaxed);
+#endif
+  TaskGroup* g = tls_task_group;
+  if (g != nullptr && !g->spare_) {
+    g->push_runnext_task(task);
+  } else {
+    TaskControl::get()->inject_task(task);
+  }
+}
+
+void TaskGroup::wait(TaskWaiter* waiter, void (*remained)(void*), void* arg) {
+  if (waiter->task != nullptr) {
+    park(remained, arg);
+    return;
+  }
+  // 无栈任务中阻塞所在的工作线程，标记为阻塞调用，由监控线程接手本地队列
+  void* blocking = enter_blocking();
+  remained(arg);
+  while (waiter->futex.load(std::memory_order_acquire) == 0) {
+    futex_wait(&waiter->futex, 0);
+  }
+  exit_blocking(blocking);
+}
+
+bool TaskGroup::wait_until(TaskWaiter* waiter, void (*remained)(void*),
+                           bool (*on_timeout)(void*), void* arg,
+                           int64_t deadline_ns) {
+  if (waiter->task == nullptr) {
+    void* blocking = enter_blocking();  // 同wait
+    remained(arg);
+    bool woken = false;
+    for (;;) {
+      if (waiter->futex.load(std::memory_order_acquire) != 0) {
+        woken = true;
+        break;
+      }
+      int64_t timeout_ns = deadline_ns - monotonic_ns();
+      if (timeout_ns <= 0) {
+        break;
+      }
+      struct timespec ts = to_timespec(timeout_ns);
+      futex_wait(&waiter->futex, 0, &ts);
+    }
+    if (!woken && !on_timeout(arg)) {
+      while (waiter->futex.load(std::memory_order_acquire) == 0) {
+        futex_wait(&waiter->futex, 0);
+      }
+      woken = true;
+    }
+    exit_blocking(blocking);
+    return woken;
+  }
+
+  struct TimeoutContext {
+    TaskWaiter* waiter;
+    bool (*on_timeout)(void*);
+    void* arg;
+    bool timed_out;
+  } ctx{waiter, on_timeout, arg, false};
+  // 定时器在park之后由当前工作线程的主循环推进，此时remained已经登记好waiter
+  TimerNode* timer = tls_task_group->timer_wheel_.add(
+      deadline_ns,
+      [](void* arg) -> void {
+        auto ctx = static_cast<TimeoutContext*>(arg);
+        if (ctx->on_timeout(ctx->arg)) {
+          ctx->timed_out = true;
+          wake(ctx->waiter);
+        }
+      },
+      &ctx);
+  park(remained, arg);
+  // 被唤醒者唤醒时取消定时器；定时任务正在运行时等待其完成，之后才能释放ctx
+  TimerWheel::cancel(timer);
+  return !ctx.timed_out;
+}
+
+bool TaskGroup::wait_unlock_until(TaskWaiter* waiter, utils::SpinMutex* mu,
+                                  WaiterList<TaskWaiter>* waiters,
+                                  int64_t deadline_ns) {
+  struct Context {
+    TaskWaiter* waiter;
+    utils::SpinMutex* mu;
+    WaiterList<TaskWaiter>* waiters;
+  } ctx{waiter, mu, waiters};
+  return wait_until(
+      waiter,
+      [](void* arg) -> void { static_cast<Context*>(arg)->mu->unlock(); },
+      [](void* arg) -> bool {
+        auto ctx = static_cast<Context*>(arg);
+        std::lock_guard<utils::SpinMutex> lock(*ctx->mu);
+        if (!ctx->waiters->linked(ctx->waiter)) {
+          return false;
+        }
+        ctx->waiters->erase(ctx->waiter);
+        return true;
+      },
+      &ctx, deadline_ns);
+}
+
+void TaskGroup::wake(TaskWaiter* waiter) {
+  if (waiter->task != nullptr) {
+    ready_to_run(waiter->task);
+    return;
+  }
+  // 置1之后等待者可能已经返回，waiter所在的栈被复用，futex_wake最多产生一次无害的唤醒
+  waiter->futex.store(1, std::memory_order_release);
+  futex_wake(&waiter->futex, 1);
+}
+
+void TaskGroup::join(TaskMeta* task) {
+  if (task->waiter.load(std::memory_order_acquire) == TaskMeta::waiter_done()) {
+    return;
+  }
+  TaskWaiter waiter;
+  waiter.task = current_task();
+  std::pair<TaskMeta*, TaskWaiter*> ctx(task, &waiter);
+  wait(
+      &waiter,
+      [](void* arg) -> void {
+        auto ctx = static_cast<std::pair<TaskMeta*, TaskWaiter*>*>(arg);
+        TaskWaiter* expected = nullptr;
+        if (!ctx->first->waiter.compare_exchange_strong(
+                expected, ctx->second, std::memory_order_acq_rel)) {
+          wake(ctx->second);  // 已经完成
+        }
+      },
+      &ctx);
+}
+
+bool TaskGroup::join_until(TaskMeta* task, int64_t deadline_ns) {
+  if (task->waiter.load(std::memory_order_acquire) == TaskMeta::waiter_done()) {
+    return true;
+  }
+  TaskWaiter waiter;
+  waiter.task = current_task();
+  std::pair<TaskMeta*, TaskWaiter*> ctx(task, &waiter);
+  return wait_until(
+      &waiter,
+      [](void* arg) -> void {
+        auto ctx = static_cast<std::pair<TaskMeta*, TaskWaiter*>*>(arg);
+        TaskWaiter* expected = nullptr;
+        if (!ctx->first->waiter.compare_exchange_strong(
+                expected, ctx->second, std::memory_order_acq_rel)) {
+          wake(ctx->second);  // 已经完成
+        }
+      },
+      [](void* arg) -> bool {
+        // 撤销登记，失败表示task已经完成并取走了waiter
+        auto ctx = static_cast<std::pair<TaskMeta*, TaskWaiter*>*>(arg);
+        TaskWaiter* expected = ctx->second;
+        return ctx->first->waiter.compare_exchange_strong(
+            expected, nullptr, std::memory_order_acq_rel);
+      },
+      &ctx, deadline_ns);
+}
+
+void TaskGroup::sleep_until(int64_t deadline_ns) {
+  TaskGroup* g = tls_task_group;
+  if (g == nullptr || g->in_stackless_) {
+    int64_t timeout_ns = deadline_ns - monotonic_ns();
+    if (timeout_ns > 0) {
+      void* blocking = enter_blocking();  // 同wait
+      std::this_thread::sleep_for(std::chrono::nanoseconds(timeout_ns));
+      exit_blocking(blocking);
+    }
+    return;
+  }
+  if (deadline_ns <= monotonic_ns()) {
+    return;
+  }
+  TimerNode* timer = g->timer_wheel_.add(
+      deadline_ns,
+      [](void* task) -> void { ready_to_run(static_cast<TaskMeta*>(task)); },
+      g->curr_task_);
+  park(nullptr, nullptr);
+  TimerWheel::cancel(timer);  // 定时任务已经完成，只释放引用
+}
+
 void TaskGroup::run_main_task(TaskControl* task_control, size_t idx) {
   // 初始化task_group，即tls_task_group
   tls_task_group = new (std::nothrow)
-      TaskGroup(task_control, task_control->alloc_parking_lot(idx));
+      TaskGroup(task_control);
   assert(tls_task_group != nullptr);
 
+  tls_task_group->init_signal_stack();
+#ifdef TASK_COROUTINE_SANITIZER
+  tls_task_group->main_task_->fiber = sanitizer_current_fiber();
+#endif
+
   // 设置task_group并等待所有task_group初始化完成
   task_control->set_task_group(idx, tls_task_group);
   task_control->wait_init_task_groups_completed();
@@ -80,7 +651,11 @@ void TaskGroup::run_main_task(TaskControl* task_control, size_t idx) {
   TaskMeta* next_task;
   for (;;) {
     g->wait_task(&next_task);
-    g->curr_task_ = next_task;
+    if (next_task->stackless) {
+      g->run_stackless_task(next_task);
+      continue;
+    }
+    g->set_curr_task(next_task);
 
 #ifdef TASK_COROUTINE_DEBUG
     sched_to(g->main_task_, next_task, "run_main_task");
@@ -89,23 +664,74 @@ void TaskGroup::run_main_task(TaskControl* task_control, size_t idx) {
     sched_to(g->main_task_, next_task);
 #endif
 
-    if (g->yield_task_ != nullptr) {  // reschedule后重新入队
-      auto tg = g_task_control->choose_one_task_group();
-      tg->sq_.push(g->yield_task_);
-#ifdef USE_PARKING_LOT
-      tg->parking_lot_->notify();
-#endif
-      g->yield_task_ = nullptr;
+    if (g->remained_fn_ != nullptr) {  // park后执行remained
+      void (*remained)(void*) = g->remained_fn_;
+      g->remained_fn_ = nullptr;
+      remained(g->remained_arg_);
+    }
+    if (g->stackless_task_ != nullptr) {  // jump_fn取到无栈任务
+      TaskMeta* task = g->stackless_task_;
+      g->stackless_task_ = nullptr;
+      g->run_stackless_task(task);
     }
   }
   delete tls_task_group;
   return;
 }
 
+void TaskGroup::run_spare_task(TaskControl* task_control, TaskGroup* g) {
+  tls_task_group = g;
+  g->init_signal_stack();
+#ifdef TASK_COROUTINE_SANITIZER
+  g->main_task_->fiber = sanitizer_current_fiber();  // 临时线程复用task_group
+#endif
+  g->retiring_ = false;
+
+  TaskMeta* next_task;
+  for (;;) {
+    g->wait_task(&next_task);
+    if (g->retiring_) {
+      break;
+    }
+    if (next_task->stackless) {
+      g->run_stackless_task(next_task);
+      continue;
+    }
+    g->set_curr_task(next_task);
+    sched_to(g->main_task_, next_task);
+    if (g->remained_fn_ != nullptr) {
+      void (*remained)(void*) = g->remained_fn_;
+      g->remained_fn_ = nullptr;
+      remained(g->remained_arg_);
+    }
+    if (g->stackless_task_ != nullptr) {
+      TaskMeta* task = g->stackless_task_;
+      g->stackless_task_ = nullptr;
+      g->run_stackless_task(task);
+    }
+    if (g->retiring_) {  // 由jump_fn切换回来
+      break;
+    }
+  }
+  g->try_destory_done_task();
+  g->curr_task_ = g->main_task_;
+
+  stack_t ss;
+  ss.ss_sp = nullptr;
+  ss.ss_size = 0;
+  ss.ss_flags = SS_DISABLE;
+  sigaltstack(&ss, nullptr);
+  tls_task_group = nullptr;
+  // 之后task_group可能被新的临时线程使用，不能再访问g
+  task_control->retire_spare(g);
+}
+
 void TaskGroup::jump_fn() {
+  sanitizer_finish_switch(nullptr);
   TaskGroup* g = tls_task_group;
   // 1. 运行当前task
   TaskMeta* curr_task = g->curr_task_;
+  g->ntasks_run_.add();
 #ifdef TASK_COROUTINE_DEBUG
   // 标记已经运行过
   if (curr_task->state.fetch_or(TaskMeta::state_start_run) &
@@ -124,6 +750,12 @@ void TaskGroup::jump_fn() {
   }
 #endif
   curr_task->run();
+  // 唤醒join的等待者
+  TaskWaiter* waiter = curr_task->waiter.exchange(TaskMeta::waiter_done(),
+                                                  std::memory_order_acq_rel);
+  if (waiter != nullptr) {
+    wake(waiter);
+  }
   g = tls_task_group;  // 有可能换出后重新调度回来，task_group发生变化
   // 2. 释放上一个运行完成的task的资源
   g->try_destory_done_task();
@@ -132,8 +764,18 @@ void TaskGroup::jump_fn() {
   // 4. 获取下一个运行的task
   TaskMeta* next_task;
   g->wait_task(&next_task);
-  // 5. 设置当前运行的task
-  g->curr_task_ = next_task;
+  // 5. 设置当前运行的task，临时线程退出时回到主函数；
+  //    无栈任务回到主函数运行，当前协程的栈可能很小
+  if (next_task == g->main_task_) {
+    g->curr_task_ = next_task;
+    sched_to(curr_task, next_task);
+  }
+  if (next_task->stackless) {
+    g->stackless_task_ = next_task;
+    g->curr_task_ = g->main_task_;
+    sched_to(curr_task, g->main_task_);
+  }
+  g->set_curr_task(next_task);
   // 6. 保存上下文，切换栈
 #ifdef TASK_COROUTINE_DEBUG
   printf("%s:%d thread_id = %lu, done {id = %lu}{stack = %p}\n", __FILE__,
@@ -145,4 +787,68 @@ void TaskGroup::jump_fn() {
 #endif
 }
 
+void TaskGroup::run_stackless_task(TaskMeta* task) {
+  try_destory_done_task();  // 已经在主函数栈上，可以释放上一个完成的协程
+  set_running_task(task);
+  nstackless_run_.add();
+  in_stackless_ = true;  // f中的等待走futex路径，见current_task
+  task->fn(task->arg);
+  in_stackless_ = false;
+  running_task_.store(nullptr, std::memory_order_relaxed);
+  StacklessTask::free(task);
+}
+
+void TaskGroup::install_stack_overflow_handler() {
+  struct sigaction sa;
+  sa.sa_sigaction = stack_overflow_handler;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGSEGV, &sa, &g_old_segv_action);
+}
+
+void TaskGroup::init_signal_stack() {
+  constexpr size_t signal_stack_size = 1024 * 64;
+  if (signal_stack_ == nullptr) {
+    signal_stack_ = malloc(signal_stack_size);  // task_group不释放，不需要释放
+    if (signal_stack_ == nullptr) {
+      return;
+    }
+  }
+  stack_t ss;
+  ss.ss_sp = signal_stack_;
+  ss.ss_size = signal_stack_size;
+  ss.ss_flags = 0;
+  sigaltstack(&ss, nullptr);
+}
+
+void TaskGroup::stack_overflow_handler(int sig, siginfo_t* info,
+                                       void* ucontext) {
+  TaskGroup* g = tls_task_group;
+  if (g != nullptr && g->curr_task_ != nullptr &&
+      in_stack_guard(g->curr_task_->memory, g->curr_task_->stack_type,
+                     info->si_addr)) {
+    char buf[256];
+    int n = snprintf(buf, sizeof(buf),
+                     "task_coroutine: stack overflow, task_meta = %p, "
+                     "stack_size = %lu, fault addr = %p\n",
+                     (void*)g->curr_task_,
+                     stack_size(g->curr_task_->stack_type), info->si_addr);
+    if (n > 0) {
+      write(STDERR_FILENO, buf, static_cast<size_t>(n));
+    }
+    // 恢复默认处理，返回后重新触发SIGSEGV，进程终止并产生core
+    signal(SIGSEGV, SIG_DFL);
+    return;
+  }
+  // 不是协程栈溢出，交给原来的处理方式
+  if (g_old_segv_action.sa_flags & SA_SIGINFO) {
+    g_old_segv_action.sa_sigaction(sig, info, ucontext);
+  } else if (g_old_segv_action.sa_handler != SIG_DFL &&
+             g_old_segv_action.sa_handler != SIG_IGN) {
+    g_old_segv_action.sa_handler(sig);
+  } else {
+    sigaction(SIGSEGV, &g_old_segv_action, nullptr);
+  }
+}
+
 }  // namespace task_coroutine
@@ -1,35 +1,62 @@
 #pragma once
 
 #include <assert.h>
+#include <signal.h>
 
 #include "task_meta.h"
 #include "task_parking_lot.h"
 #include "task_scheduling_queue.hpp"
+#include "task_stats.h"
+#include "task_timer.h"
+#include "task_waiter.h"
+#include "task_work_stealing_queue.hpp"
+#include "utils/spin_mutex.h"
 
 namespace task_coroutine {
 
 class TaskControl;
+class TaskGroup;
+
+extern thread_local TaskGroup* tls_task_group;  // 每个工作线程的task_group
 
 class TaskGroup {
  public:
-  TaskGroup(TaskControl* task_control, ParkingLot* parking_lot);
+  // spare为true时是接手阻塞的task_group的临时线程，见run_spare_task
+  explicit TaskGroup(TaskControl* task_control, bool spare = false);
 
-  // wait_task 等待获取任务
+  // wait_task 等待获取任务，找不到任务时先自旋，再park直到被signal_task唤醒
+  // 有定时任务时最多park到下一个需要推进时间轮的时间
   void wait_task(TaskMeta** task);
 
-  // add_task 添加任务
-  TaskMeta* add_task(void* fn(void*), void* arg) {
-    TaskMeta* task = TaskMeta::new_task(fn, arg, TaskGroup::jump_fn);
-    if (task == nullptr) {
-      return nullptr;
+  // unpark 唤醒park中的工作线程，由TaskControl::signal_task调用
+  void unpark() { parking_lot_.unpark(); }
+
+  // start_task 新创建的任务入队
+  // 工作线程中放入当前task_group的本地队列，由空闲的工作线程窃取；
+  // 非工作线程中放入TaskControl的全局注入队列，不与工作线程的本地队列竞争
+  static void start_task(TaskMeta* task);
+
+  // push_task 任务入队，按task->priority放入对应优先级的队列
+  // 所属工作线程直接push到无锁的rq_，其他线程或rq_已满时push到remote_rq_
+  void push_task(TaskMeta* task);
+
+  // push_tasks 批量入队，一次remote_rq_加锁，只调用一次signal_task
+  // 批量创建的任务优先级相同，按tasks[0]->priority入队
+  void push_tasks(TaskMeta* const* tasks, size_t n);
+
+  // handoff_tasks 把任务交给由TaskControl::take_idle取出的空闲task_group并唤醒它
+  void handoff_tasks(TaskMeta* const* tasks, size_t n) {
+    if (n > 0) {
+      remote_rq_[priority_index(tasks[0])].push_batch(tasks, n);
     }
-    sq_.push(task);
-#ifdef USE_PARKING_LOT
-    parking_lot_->notify();
-#endif
-    return task;
+    parking_lot_.unpark();
   }
 
+  // push_runnext_task 被唤醒的任务入队，只能由所属工作线程调用
+  // 放入runnext_作为下一个运行的任务，保持唤醒者与被唤醒者之间的缓存局部性，
+  // 原来的runnext_放入rq_。BATCH任务直接放入rq_，不抢占其他任务
+  void push_runnext_task(TaskMeta* task);
+
   // try_destory_done_task 修改done_task的状态，并尝试释放资源
   void try_destory_done_task() {
     if (done_task_ != nullptr) {
@@ -47,9 +74,145 @@ class TaskGroup {
   // 回到主函数的原因：只有主函数接下来执行的代码是明确的，其他task有可能是进入jump_fn或回到换出点
   static void reschedule();
 
+  // park 换出当前协程且不重新入队，回到主函数后执行remained(arg)
+  // remained执行时当前协程的栈已不再使用，可以在其中把当前协程登记为等待者，
+  // 之后由其他线程调用ready_to_run重新入队。只能在工作线程的协程中调用
+  static void park(void (*remained)(void*), void* arg);
+
+  // ready_to_run 被park的协程重新入队，可以在任意线程调用
+  // 工作线程中放入当前task_group的runnext_，非工作线程放入全局注入队列
+  static void ready_to_run(TaskMeta* task);
+
+  // wait 等待waiter被wake，waiter.task需要已经设置好
+  // 协程：park后执行remained(arg)登记waiter；非工作线程：先执行remained(arg)再阻塞在futex上
+  static void wait(TaskWaiter* waiter, void (*remained)(void*), void* arg);
+
+  // wait_until 带超时的wait，deadline_ns为monotonic_ns，返回值：false表示超时
+  // 到达deadline时调用on_timeout(arg)（协程：在定时器所在工作线程；非工作线程：在当前线程），
+  // on_timeout需要在登记waiter时使用的锁保护下撤销登记，撤销成功返回true；
+  // 返回false表示唤醒者已经取走waiter，之后一定会wake
+  static bool wait_until(TaskWaiter* waiter, void (*remained)(void*),
+                         bool (*on_timeout)(void*), void* arg,
+                         int64_t deadline_ns);
+
+  // wake 唤醒waiter，每个waiter只能被唤醒一次
+  static void wake(TaskWaiter* waiter);
+
+  // wait_unlock 等待waiter被wake，在当前协程换出后（非工作线程为阻塞前）释放mu
+  // 用于先在mu保护下登记waiter，再等待的场景：唤醒者需要持有mu才能取出waiter，
+  // 因此不会在当前协程换出完成之前把它重新入队
+  static void wait_unlock(TaskWaiter* waiter, utils::SpinMutex* mu) {
+    wait(
+        waiter,
+        [](void* mu) -> void { static_cast<utils::SpinMutex*>(mu)->unlock(); },
+        mu);
+  }
+
+  // wait_unlock_until 带超时的wait_unlock，waiter登记在由mu保护的waiters中
+  // 超时时在mu保护下把waiter从waiters中移除，返回值：false表示超时
+  static bool wait_unlock_until(TaskWaiter* waiter, utils::SpinMutex* mu,
+                                WaiterList<TaskWaiter>* waiters,
+                                int64_t deadline_ns);
+
+  // current_task 当前运行的协程，非工作线程和无栈任务中返回nullptr
+  // 返回nullptr时等待原语阻塞在futex上而不是park
+  static TaskMeta* current_task() {
+    return tls_task_group != nullptr && !tls_task_group->in_stackless_
+               ? tls_task_group->curr_task_
+               : nullptr;
+  }
+
+  // join 等待task完成fn(arg)，协程中park，非工作线程阻塞在futex上
+  static void join(TaskMeta* task);
+
+  // join_until 带超时的join，返回值：false表示超时，task尚未完成，之后可以再次join
+  static bool join_until(TaskMeta* task, int64_t deadline_ns);
+
+  // sleep_until 当前协程休眠到deadline_ns（monotonic_ns），由所在工作线程的时间轮唤醒
+  // 非工作线程中调用时阻塞当前线程
+  static void sleep_until(int64_t deadline_ns);
+
+  // migration_count 在当前task_group运行、上次在其他task_group运行的次数
+  size_t migration_count() const { return nmigrations_.get(); }
+
+  // stats 读取调度统计，可以在任意线程调用，不暂停所属工作线程
+  TaskGroupStats stats() const;
+
+  // running_task 正在运行的协程，寻找任务时为nullptr，供监控线程读取
+  // 监控线程只用来比较，不能访问：协程可能刚好结束，TaskMeta已经释放或复用
+  TaskMeta* running_task() const {
+    return running_task_.load(std::memory_order_relaxed);
+  }
+
+  // running_spawn_file/running_spawn_line 正在运行的协程的创建位置，
+  // 切换时从TaskMeta复制，供监控线程读取，字符串总是静态的
+  const char* running_spawn_file() const {
+    return running_file_.load(std::memory_order_relaxed);
+  }
+
+  int running_spawn_line() const {
+    return running_line_.load(std::memory_order_relaxed);
+  }
+
+  // sched_seq 调度序号，每次切换到协程或运行无栈任务加1，供监控线程判断任务是否一直在运行
+  size_t sched_seq() const {
+    return ncontext_switches_.get() + nstackless_run_.get();
+  }
+
+  // request_yield 设置should_yield标记，由监控线程调用，下次调度时清除
+  void request_yield() { should_yield_.store(true, std::memory_order_relaxed); }
+
+  // should_yield 当前工作线程正在运行的协程是否超过了时间片，应该让出
+  static bool should_yield() {
+    TaskGroup* g = tls_task_group;
+    return g != nullptr && g->should_yield_.load(std::memory_order_relaxed);
+  }
+
+  // maybe_yield should_yield时让出当前协程，设置为utils::g_maybe_yield_fn（见utils/task_hooks.h）
+  static void maybe_yield();
+
+  // enter_blocking 当前协程进入阻塞调用，设置为utils::g_enter_blocking_fn（见utils/task_hooks.h）
+  // 返回当前task_group，传给exit_blocking；非工作线程和主函数（不在无栈任务中）返回nullptr。可以嵌套
+  static void* enter_blocking();
+
+  // exit_blocking 阻塞调用返回，设置为utils::g_exit_blocking_fn
+  static void exit_blocking(void* task_group);
+
+  // blocking_since_ns 所属工作线程进入阻塞调用的时间（monotonic_ns），不在阻塞调用中时为0
+  int64_t blocking_since_ns() const {
+    return blocking_since_ns_.load(std::memory_order_relaxed);
+  }
+
+  // has_queued_tasks 本地队列中是否有任务，供监控线程判断是否需要接手
+  bool has_queued_tasks() const {
+    return runnext_.load(std::memory_order_relaxed) != nullptr ||
+           queue_depth() > 0;
+  }
+
+  bool spare() const { return spare_; }
+
+  // handoff_from 临时线程正在接手的task_group，临时线程退出后为nullptr
+  // 由TaskControl在spare_mu_保护下修改，临时线程运行期间不变
+  TaskGroup* handoff_from() const { return handoff_from_; }
+
+  void set_handoff_from(TaskGroup* task_group) { handoff_from_ = task_group; }
+
   // sched_to 从from调度/切换到to，切换栈和上下文
+  // 切换前检查两者的栈顶标记，COMPACT栈没有保护页，越界到相邻的栈时在这里发现
   static void sched_to(TaskMeta* from, TaskMeta* to) {
+    from->check_stack_canary();
+    to->check_stack_canary();
+#ifdef TASK_COROUTINE_SANITIZER
+    void* fake_stack = nullptr;
+    bool done = from->state.load(std::memory_order_relaxed) &
+                TaskMeta::state_fn_done;
+    sanitizer_start_switch(done ? nullptr : &fake_stack, to->memory,
+                           to->stack_type, to->fiber);
+    task_coroutine_jump_fcontext(&from->stack, to->stack);
+    sanitizer_finish_switch(fake_stack);
+#else
     task_coroutine_jump_fcontext(&from->stack, to->stack);
+#endif
   }
 
 #ifdef TASK_COROUTINE_DEBUG
@@ -60,27 +223,176 @@ class TaskGroup {
         "stack = %p}\n",
         __FILE__, __LINE__, thread_id, msg, from->id, from->stack, to->id,
         to->stack);
-    task_coroutine_jump_fcontext(&from->stack, to->stack);
+    sched_to(from, to);
   }
 #endif
 
   // run_main_task task_group线程（worker thread）运行的主函数
   static void run_main_task(TaskControl* task_control, size_t idx);
 
+  // run_spare_task 临时线程的主函数，由TaskControl在g->handoff_from()阻塞时启动
+  // 1. 依次从本地队列、阻塞的task_group、全局注入队列获取任务
+  // 2. 创建和唤醒的任务放入全局注入队列，不在临时线程上积压
+  // 3. 阻塞的task_group返回或空闲超过SPARE_IDLE_NS后，运行完本地任务和未取消的定时任务后退出
+  static void run_spare_task(TaskControl* task_control, TaskGroup* g);
+
   // jump_fn
   // 调度一个新的task时跳转的函数，设置在new_task的上下文中，如果是重新入队后调度的task，会回到上次运行的地方
   static void jump_fn();
 
+  // install_stack_overflow_handler
+  // 安装SIGSEGV处理函数，访问到当前协程栈的保护页时报告栈溢出，进程只需安装一次
+  static void install_stack_overflow_handler();
+
  private:
-  TaskSchedulingQueue<TaskMeta*> sq_;  // 调度队列
+  // init_signal_stack 为当前线程设置备用信号栈，栈溢出时处理函数无法在原栈上运行
+  // 备用信号栈属于task_group，临时线程退出后由下一个使用该task_group的线程复用
+  void init_signal_stack();
+
+  // wait_spare_task 临时线程获取任务，返回值：false表示应该退出
+  bool wait_spare_task(TaskMeta** task);
+
+  // run_stackless_task 在主函数栈上运行无栈任务并释放，见post
+  void run_stackless_task(TaskMeta* task);
+
+  static void stack_overflow_handler(int sig, siginfo_t* info, void* ucontext);
+
+  // steal_task 从victim窃取任务，成功时额外窃取victim中约一半的任务放入本地rq_
+  // victim的rq_和remote_rq_都为空且steal_runnext为true时窃取runnext_
+  bool steal_task(TaskGroup* victim, TaskMeta** task, bool steal_runnext);
+
+  // set_curr_task 设置当前运行的task，task上次在其他task_group运行时计为一次迁移
+  void set_curr_task(TaskMeta* task) {
+    if (task->group != this) {
+      if (task->group != nullptr) {
+        nmigrations_.add();
+      }
+      task->group = this;
+    }
+    curr_task_ = task;
+    set_running_task(task);
+#ifdef TASK_COROUTINE_REGISTRY
+    task->record.state.store(TaskRunState::RUNNING, std::memory_order_relaxed);
+    task->record.last_run_ns.store(TaskRegistry::now_ns(),
+                                   std::memory_order_relaxed);
+#endif
+    ncontext_switches_.add();
+    if (should_yield_.load(std::memory_order_relaxed)) {
+      should_yield_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  // set_running_task 记录正在运行的协程及其创建位置，供监控线程读取
+  void set_running_task(TaskMeta* task) {
+    running_task_.store(task, std::memory_order_relaxed);
+    running_file_.store(task->spawn_file, std::memory_order_relaxed);
+    running_line_.store(task->spawn_line, std::memory_order_relaxed);
+  }
+
+  // run_timers 运行到期的定时任务，到期的协程放入本地队列
+  void run_timers() {
+    if (!timer_wheel_.empty()) {
+      timer_wheel_.advance(monotonic_ns());
+    }
+  }
+
+  // pop_local_task 从本地队列获取任务，依次为runnext_、各优先级的rq_/remote_rq_、全局注入队列
+  // 每SCHED_FAIRNESS_INTERVAL次调度先轮流检查一次remote_rq_或全局注入队列，
+  // 连续MAX_RUNNEXT_STREAK次运行runnext_后把它放入remote_rq_，避免互相唤醒的协程饿死队列中的任务
+  bool pop_local_task(TaskMeta** task);
+
+  // pop_weighted_task 按权重从各优先级的队列中取任务
+  // 每轮各优先级最多取PRIORITY_WEIGHTS[i]个，从高到低选择还有配额且有任务的优先级；
+  // 有任务的优先级都用完配额时开始新的一轮。高优先级任务持续到来时，
+  // 低优先级任务每轮至少运行一次，等待最多一轮（约sum(PRIORITY_WEIGHTS)次调度）
+  bool pop_weighted_task(TaskMeta** task);
+
+  // pop_priority_task 从优先级i的rq_和remote_rq_取任务
+  bool pop_priority_task(size_t i, TaskMeta** task) {
+    return rq_[i].pop(*task) || remote_rq_[i].try_pop(*task);
+  }
+
+  // pop_remote_task 按优先级从高到低检查remote_rq_
+  bool pop_remote_task(TaskMeta** task);
+
+  // push_local_task 放入task优先级的rq_，rq_已满时放入remote_rq_，只能由所属工作线程调用
+  void push_local_task(TaskMeta* task) {
+    size_t i = priority_index(task);
+    if (!rq_[i].push(task)) {
+      remote_rq_[i].push(task);
+    }
+  }
+
+  // queue_depth 本地各队列的近似长度之和
+  size_t queue_depth() const;
+
+  static size_t priority_index(const TaskMeta* task) {
+    return static_cast<size_t>(task->priority);
+  }
+
+  // pop_inject_task 取走全局注入队列中的全部任务，最早入队的一个作为返回值，
+  // 其余放入rq_，多于一个时唤醒空闲的工作线程来窃取
+  bool pop_inject_task(TaskMeta** task);
+
+  // find_task 依次从到期的定时任务、本地队列、其他task_group获取任务
+  // steal_runnext为true时也窃取其他task_group的runnext_
+  bool find_task(TaskMeta** task, bool steal_runnext);
+
+  // stop_spinning 停止自旋，最后一个自旋的工作线程找到任务时再唤醒一个空闲的工作线程
+  void stop_spinning();
+
+  static constexpr size_t MIN_SPIN_ROUNDS = 4;
+  static constexpr size_t MAX_SPIN_ROUNDS = 256;
+  static constexpr size_t SCHED_FAIRNESS_INTERVAL = 61;
+  static constexpr size_t MAX_RUNNEXT_STREAK = 16;
+  static constexpr size_t PRIORITY_WEIGHTS[TASK_PRIORITY_NUM] = {8, 4, 1};
+  static constexpr int64_t SPARE_IDLE_NS = 10000000;  // 临时线程空闲10ms后退出
+  static constexpr int64_t SPARE_POLL_NS = 1000000;   // 临时线程空闲时的轮询间隔
+
+  std::atomic<TaskMeta*> runnext_;  // 所属工作线程刚唤醒/创建的任务，下一个运行
+  // 每个优先级一组队列，下标为TaskPriority
+  WorkStealingQueue<TaskMeta*> rq_[TASK_PRIORITY_NUM];  // 本地调度队列，只有所属工作线程push/pop
+  TaskSchedulingQueue<TaskMeta*>
+      remote_rq_[TASK_PRIORITY_NUM];  // 其他线程添加和yield的任务，先进先出
+  size_t credits_[TASK_PRIORITY_NUM];  // 本轮各优先级剩余的出队配额
+  size_t sched_tick_;      // 减到0时先检查remote_rq_或全局注入队列，用于公平调度
+  bool tick_inject_;       // sched_tick_减到0时检查的是否为全局注入队列，每次轮换
+  size_t runnext_streak_;  // 连续运行runnext_的次数
+  TimerWheel timer_wheel_;  // 定时任务，只有所属工作线程添加和推进
   TaskControl* task_control_;          // 所属的task_control
-  ParkingLot* parking_lot_;            // 用于等待任务的条件
+  ParkingLot parking_lot_;             // 空闲时park
+  bool spinning_;                      // 是否计入TaskControl的nspinning_
+  size_t spin_rounds_;  // park之前的自旋轮数，根据自旋是否找到任务自适应调整
   TaskMeta* main_task_;                // 线程main函数
   TaskMeta* curr_task_;                // 当前运行的task
   TaskMeta* done_task_;   // 上一个执行完成的task，需要释放内存
-  TaskMeta* yield_task_;  // 被换出的task，用于reschedule重新调度
-};
+  void (*remained_fn_)(void*);  // 切换回main_task后执行，由park设置
+  void* remained_arg_;
+  TaskMeta* stackless_task_;  // jump_fn取到的无栈任务，切换回main_task后运行
+  bool in_stackless_;         // 正在主函数栈上运行无栈任务
+  std::atomic<TaskMeta*> running_task_;  // 正在运行的协程，供监控线程读取
+  std::atomic<const char*> running_file_;  // running_task_的创建位置
+  std::atomic<int> running_line_;
+  std::atomic<bool> should_yield_;  // 当前协程超过时间片，由监控线程设置
+  std::atomic<int64_t> blocking_since_ns_;  // 进入阻塞调用的时间，供监控线程读取
+  size_t blocking_depth_;                   // 嵌套的BlockingScope层数
+  const bool spare_;                        // 是否为临时线程
+  TaskGroup* handoff_from_;  // 临时线程接手的task_group
+  bool retiring_;            // 临时线程准备退出
+  void* signal_stack_;       // 备用信号栈
 
-extern thread_local TaskGroup* tls_task_group;  // 每个工作线程的task_group
+  // 调度统计，只有所属工作线程修改，见TaskGroupStats
+  const int64_t start_ns_;  // 创建时间，用于计算运行时间
+  StatCounter ntasks_run_;
+  StatCounter ncontext_switches_;
+  StatCounter nstackless_run_;
+  StatCounter nmigrations_;
+  StatCounter nsteal_attempts_;
+  StatCounter nsteals_;
+  StatCounter nparks_;
+  StatCounter nunparks_;
+  StatCounter queue_depth_max_;
+  StatCounter idle_ns_;
+};
 
 }  // namespace task_coroutine
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+
+#include "task_meta.h"
+
+namespace task_coroutine {
+
+// TaskInjectQueue 非工作线程提交任务的全局注入队列
+// 1. 侵入式，通过TaskMeta::next链接，入队不分配内存
+// 2. 生产者CAS压入链表头，无锁，不与工作线程的本地队列竞争
+// 3. 消费者（工作线程）exchange一次取走整个链表，多个消费者之间也不需要加锁，
+//    取走的链表为后进先出的顺序
+class TaskInjectQueue {
+ public:
+  TaskInjectQueue() : head_(nullptr) {}
+
+  TaskInjectQueue(const TaskInjectQueue&) = delete;
+  TaskInjectQueue& operator=(const TaskInjectQueue&) = delete;
+
+  void push(TaskMeta* task) { push_list(task, task); }
+
+  // push_batch 链接n个任务，一次CAS入队
+  void push_batch(TaskMeta* const* tasks, size_t n) {
+    if (n == 0) {
+      return;
+    }
+    for (size_t i = n - 1; i > 0; --i) {
+      tasks[i]->next = tasks[i - 1];
+    }
+    push_list(tasks[n - 1], tasks[0]);
+  }
+
+  // pop_all 取走全部任务，返回链表头（最后入队的任务），通过next遍历，空时返回nullptr
+  TaskMeta* pop_all() {
+    if (head_.load(std::memory_order_relaxed) == nullptr) {
+      return nullptr;  // 先读再exchange，空闲轮询时不写缓存行
+    }
+    return head_.exchange(nullptr, std::memory_order_acquire);
+  }
+
+  bool empty() const { return head_.load(std::memory_order_relaxed) == nullptr; }
+
+ private:
+  // push_list 把first->...->last压入链表头
+  void push_list(TaskMeta* first, TaskMeta* last) {
+    TaskMeta* head = head_.load(std::memory_order_relaxed);
+    do {
+      last->next = head;
+    } while (!head_.compare_exchange_weak(head, first, std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+
+  alignas(64) std::atomic<TaskMeta*> head_;
+  char padding_[64 - sizeof(std::atomic<TaskMeta*>)];
+};
+
+}  // namespace task_coroutine
@@ -2,6 +2,7 @@
 
 #include "define.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <atomic>
 #include <cstdio>
@@ -12,9 +13,17 @@
 #endif
 
 #include "task_context.h"
+#include "task_meta_pool.h"
+#include "task_registry.h"
+#include "task_sanitizer.h"
+#include "task_stack.h"
+#include "task_waiter.h"
 
 namespace task_coroutine {
 
+class TaskGroup;
+class TaskScope;
+
 #ifdef TASK_COROUTINE_DEBUG
 extern std::atomic<size_t> g_task_meta_created_count;
 extern std::atomic<size_t> g_task_meta_destroy_count;
@@ -30,9 +39,6 @@ extern std::atomic<size_t> g_task_meta_destroy_count;
 // （2）从换出点切回
 // （3）reschedule进入到run_main_task
 
-// TODO:
-// 1. 优化栈分配，懒加载
-
 // TaskMeta
 // 生命周期由与其关联的coroutine和将其执行完成的task_group共同管理，原因：
 // 1. coroutine join时需要task_meta存在，在coroutine未析构时，task_meta不能析构
@@ -45,8 +51,26 @@ struct TaskMeta {
   void* (*fn)(void*);
   void* arg;
   void* stack;
-  void* memory;
+  void* memory;  // alloc_stack分配的栈内存，包括保护页
+  StackType stack_type;
   std::atomic<size_t> state;
+  std::atomic<TaskWaiter*> waiter;  // join的等待者，完成后置为waiter_done()
+  TaskMeta* next;  // TaskMetaPool空闲链表中的下一个
+  TaskGroup* group;  // 上次运行所在的task_group，用于统计迁移次数
+  void (*destroy_fn)(void*);  // 不为nullptr时destory调用destroy_fn(arg)，析构栈顶保留内存中的对象
+  TaskPriority priority;  // 优先级类别，决定放入task_group的哪个队列
+  const char* spawn_file;  // 创建协程的位置，见TaskAttr
+  int spawn_line;
+  TaskScope* scope;  // 由TaskScope::spawn创建时所属的TaskScope，用于协作式取消
+  bool stackless;  // 无栈任务，没有栈和Coroutine，在task_group的主函数栈上运行完成，见post
+  void* stack_trimmed;  // COMPACT栈上次trim_stack的返回值
+  const uint64_t* canary;  // 栈顶标记，没有栈时为nullptr，见task_stack.h
+#ifdef TASK_COROUTINE_REGISTRY
+  TaskRecord record;  // 协程注册表使用的字段，见task_registry.h
+#endif
+#ifdef TASK_COROUTINE_SANITIZER
+  void* fiber = nullptr;  // TSan的fiber，主函数的为所在线程的fiber，见task_sanitizer.h
+#endif
   // state 3位bit表示
   //   100  完成fn(arg)
   //   010  所属Coroutine调用析构
@@ -66,13 +90,46 @@ struct TaskMeta {
   static constexpr size_t state_coroutine_destructor = 1 << 1;
   static constexpr size_t state_task_group_sched_next_one = 1;
 
-  TaskMeta(void* (*fn_)(void*), void* arg_, void* stack_, void* memory_)
-      : fn(fn_), arg(arg_), stack(stack_), memory(memory_), state(0) {}
+  // waiter_done waiter为该值表示已经完成fn(arg)，之后不能再登记等待者
+  static TaskWaiter* waiter_done() { return reinterpret_cast<TaskWaiter*>(1); }
+
+  TaskMeta(void* (*fn_)(void*), void* arg_, void* stack_, void* memory_,
+           StackType stack_type_ = StackType::NORMAL)
+      : fn(fn_),
+        arg(arg_),
+        stack(stack_),
+        memory(memory_),
+        stack_type(stack_type_),
+        state(0),
+        waiter(nullptr),
+        next(nullptr),
+        group(nullptr),
+        destroy_fn(nullptr),
+        priority(TaskPriority::INTERACTIVE),
+        spawn_file(nullptr),
+        spawn_line(0),
+        scope(nullptr),
+        stackless(false),
+        stack_trimmed(nullptr),
+        canary(memory_ != nullptr ? stack_canary(memory_, stack_type_)
+                                  : nullptr) {}
 
   TaskMeta(const TaskMeta&) = delete;
   TaskMeta& operator=(const TaskMeta&) = delete;
 
-  ~TaskMeta() { free(memory); }
+  ~TaskMeta() {
+#ifdef TASK_COROUTINE_REGISTRY
+    if (memory != nullptr) {
+      TaskRegistry::remove(this);  // 在释放栈之前移出，注册表读取时栈仍然有效
+    }
+#endif
+#ifdef TASK_COROUTINE_SANITIZER
+    if (memory != nullptr) {
+      sanitizer_destroy_fiber(fiber);
+    }
+#endif
+    free_stack(memory, stack_type);
+  }
 
   // run 运行函数
   void run() {
@@ -86,31 +143,113 @@ struct TaskMeta {
     return new (std::nothrow) TaskMeta{nullptr, nullptr, nullptr, nullptr};
   }
 
-  // new_task 创建任务
-  // 参数：fn是运行函数，arg是函数参数，jump_fn是jump_fcontext时跳转的函数
+  // new_task 创建任务，优先复用TaskMetaPool中的TaskMeta及其栈
+  // 参数：fn是运行函数，arg是函数参数，jump_fn是jump_fcontext时跳转的函数，attr是任务属性
   // 返回值：使用null方法判空
-  static TaskMeta* new_task(void* (*fn)(void*), void* arg, void (*jump_fn)()) {
-    constexpr size_t stacksize = 1024 * 8;
-    void* m = malloc(stacksize);
+  // reserved是在栈顶保留的字节数，用于存放任务的参数等，通过reserved_memory获取
+  static TaskMeta* new_task(void* (*fn)(void*), void* arg, void (*jump_fn)(),
+                            const TaskAttr& attr, size_t reserved = 0) {
+    TaskMeta* task_meta = TaskMetaPool::get(attr.stack_type);
+    if (task_meta == nullptr) {
+      task_meta = alloc(attr.stack_type);
+      if (task_meta == nullptr) {
+        return nullptr;
+      }
+    }
+    task_meta->init(fn, arg, jump_fn, reserved);
+    task_meta->set_attr(attr);
+    return task_meta;
+  }
+
+  // new_tasks 批量创建n个任务，第i个任务运行fn(args[i])，args为nullptr时参数都为nullptr
+  // 从TaskMetaPool批量获取，不足的部分逐个分配
+  // 返回值：创建成功的个数，内存不足时小于n
+  static size_t new_tasks(void* (*fn)(void*), void* const* args, size_t n,
+                          void (*jump_fn)(), const TaskAttr& attr,
+                          TaskMeta** tasks, size_t reserved = 0) {
+    size_t got = TaskMetaPool::get_batch(attr.stack_type, tasks, n);
+    for (; got < n; ++got) {
+      tasks[got] = alloc(attr.stack_type);
+      if (tasks[got] == nullptr) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < got; ++i) {
+      tasks[i]->init(fn, args != nullptr ? args[i] : nullptr, jump_fn, reserved);
+      tasks[i]->set_attr(attr);
+    }
+    return got;
+  }
+
+  // alloc 分配TaskMeta及其栈
+  static TaskMeta* alloc(StackType stack_type) {
+    void* m = alloc_stack(stack_type);
     if (m == nullptr) {
       return nullptr;
     }
-    TaskMeta* task_meta = new (std::nothrow) TaskMeta{
-        fn, arg, task_coroutine_make_fcontext((char*)m + stacksize, jump_fn),
-        m};  // 注意stack的bottom在memory +
-             // stacksize，因为栈增长的方向是地址下降
+    TaskMeta* task_meta =
+        new (std::nothrow) TaskMeta{nullptr, nullptr, nullptr, m, stack_type};
     if (task_meta == nullptr) {
-      free(m);
+      free_stack(m, stack_type);
       return nullptr;
     }
+#ifdef TASK_COROUTINE_SANITIZER
+    task_meta->fiber = sanitizer_create_fiber();
+#endif
+#ifdef TASK_COROUTINE_REGISTRY
+    TaskRegistry::add(task_meta);
+#endif
+    return task_meta;
+  }
+
+  // init 新分配或从TaskMetaPool复用的TaskMeta重新初始化，协程栈从栈顶保留的reserved字节之下开始
+  void init(void* (*fn_)(void*), void* arg_, void (*jump_fn)(),
+            size_t reserved = 0) {
+    assert(reserved <= stack_size(stack_type) / 2);
+    fn = fn_;
+    arg = arg_;
+    state.store(0, std::memory_order_relaxed);
+    waiter.store(nullptr, std::memory_order_relaxed);
+    group = nullptr;
+    destroy_fn = nullptr;
+    stack_trimmed = nullptr;
+    sanitizer_unpoison(static_cast<char*>(memory) + stack_guard_size(stack_type),
+                       stack_size(stack_type));
+    // 注意stack的bottom在stack_top，因为栈增长的方向是地址下降
+    stack = task_coroutine_make_fcontext(reserved_memory(reserved), jump_fn);
+#ifdef TASK_COROUTINE_REGISTRY
+    record.id = TaskRegistry::next_id();
+    record.last_run_ns.store(0, std::memory_order_relaxed);
+    record.state.store(TaskRunState::CREATED, std::memory_order_relaxed);
+#endif
 #ifdef TASK_COROUTINE_DEBUG
     // 初始化task_meta的id
-    task_meta->id = g_task_meta_created_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    id = g_task_meta_created_count.fetch_add(1, std::memory_order_relaxed) + 1;
 #endif
-    return task_meta;
   }
 
-  // destory 删除任务
+  // set_attr 记录创建时的属性
+  void set_attr(const TaskAttr& attr) {
+    priority = attr.priority;
+    spawn_file = attr.file;
+    spawn_line = attr.line;
+    scope = nullptr;
+  }
+
+  // check_stack_canary 检查栈顶标记，被相邻的栈覆盖时报告栈溢出并终止进程
+  void check_stack_canary() const {
+    if (canary != nullptr && *canary != STACK_CANARY) {
+      report_stack_overwritten(memory, stack_type);
+    }
+  }
+
+  // reserved_memory 栈顶保留的reserved字节的起始地址，16字节对齐
+  void* reserved_memory(size_t reserved) const {
+    return static_cast<char*>(stack_top(memory, stack_type)) -
+           ((reserved + 15) & ~static_cast<size_t>(15));
+  }
+
+  // destory 删除任务，TaskMeta及其栈归还到TaskMetaPool
   static void destory(TaskMeta* task_meta) {
 #ifdef TASK_COROUTINE_DEBUG
     // 标记已经删除
@@ -123,7 +262,13 @@ struct TaskMeta {
     }
     g_task_meta_destroy_count.fetch_add(1, std::memory_order_relaxed);
 #endif
-    delete task_meta;
+    if (task_meta->destroy_fn != nullptr) {
+      task_meta->destroy_fn(task_meta->arg);
+    }
+#ifdef TASK_COROUTINE_REGISTRY
+    task_meta->record.state.store(TaskRunState::FREE, std::memory_order_relaxed);
+#endif
+    TaskMetaPool::put(task_meta);
   }
 };
 
@@ -0,0 +1,173 @@
+#include "task_meta_pool.h"
+
+#include <mutex>
+
+#include "task_meta.h"
+#include "utils/spin_mutex.h"
+
+namespace task_coroutine {
+
+namespace {
+
+// 大栈占用内存多，缓存数量相应减少
+constexpr size_t LOCAL_MAX_SIZES[STACK_TYPE_NUM] = {128, 128, 16, 128};
+constexpr size_t GLOBAL_MAX_SIZES[STACK_TYPE_NUM] = {8192, 4096, 256, 8192};
+
+// FreeList 单链表，使用TaskMeta::next连接
+struct FreeList {
+  TaskMeta* head = nullptr;
+  size_t size = 0;
+};
+
+// GlobalPool 所有线程共享的空闲链表，使用时new出来且不释放，避免进程退出时的析构顺序问题
+struct GlobalPool {
+  utils::SpinMutex mu;
+  FreeList lists[STACK_TYPE_NUM];
+};
+
+GlobalPool* global_pool() {
+  static GlobalPool* pool = new GlobalPool;
+  return pool;
+}
+
+// LocalPool 线程本地的空闲链表，线程退出时归还到全局链表
+struct LocalPool {
+  FreeList lists[STACK_TYPE_NUM];
+
+  ~LocalPool() {
+    for (size_t i = 0; i < STACK_TYPE_NUM; ++i) {
+      if (lists[i].size > 0) {
+        flush(i, lists[i].size);
+      }
+    }
+  }
+
+  // flush 将本地链表头部的n个TaskMeta归还到全局链表，全局链表已满时直接释放
+  void flush(size_t type, size_t n) {
+    FreeList& l = lists[type];
+    TaskMeta* first = l.head;
+    TaskMeta* last = l.head;
+    for (size_t i = 1; i < n; ++i) {
+      last = last->next;
+    }
+    l.head = last->next;
+    l.size -= n;
+
+    GlobalPool* g = global_pool();
+    {
+      std::lock_guard<utils::SpinMutex> lock(g->mu);
+      FreeList& gl = g->lists[type];
+      if (gl.size < GLOBAL_MAX_SIZES[type]) {
+        last->next = gl.head;
+        gl.head = first;
+        gl.size += n;
+        return;
+      }
+    }
+    last->next = nullptr;
+    while (first != nullptr) {
+      TaskMeta* next = first->next;
+      delete first;
+      first = next;
+    }
+  }
+
+  // fill 从全局链表获取最多n个TaskMeta
+  void fill(size_t type, size_t n) {
+    FreeList& l = lists[type];
+    GlobalPool* g = global_pool();
+    std::lock_guard<utils::SpinMutex> lock(g->mu);
+    FreeList& gl = g->lists[type];
+    while (n-- > 0 && gl.head != nullptr) {
+      TaskMeta* t = gl.head;
+      gl.head = t->next;
+      --gl.size;
+      t->next = l.head;
+      l.head = t;
+      ++l.size;
+    }
+  }
+};
+
+thread_local LocalPool tls_local_pool;
+
+}  // namespace
+
+TaskMeta* TaskMetaPool::get(StackType type) {
+  size_t i = static_cast<size_t>(type);
+  FreeList& l = tls_local_pool.lists[i];
+  if (l.head == nullptr) {
+    tls_local_pool.fill(i, LOCAL_MAX_SIZES[i] / 2);
+    if (l.head == nullptr) {
+      return nullptr;
+    }
+  }
+  TaskMeta* t = l.head;
+  l.head = t->next;
+  --l.size;
+  t->next = nullptr;
+  return t;
+}
+
+size_t TaskMetaPool::get_batch(StackType type, TaskMeta** tasks, size_t n) {
+  size_t i = static_cast<size_t>(type);
+  FreeList& l = tls_local_pool.lists[i];
+  if (l.size < n) {
+    tls_local_pool.fill(i, n - l.size);
+  }
+  size_t got = 0;
+  while (got < n && l.head != nullptr) {
+    TaskMeta* t = l.head;
+    l.head = t->next;
+    --l.size;
+    t->next = nullptr;
+    tasks[got++] = t;
+  }
+  return got;
+}
+
+void TaskMetaPool::put(TaskMeta* task_meta) {
+  size_t i = static_cast<size_t>(task_meta->stack_type);
+  FreeList& l = tls_local_pool.lists[i];
+  task_meta->next = l.head;
+  l.head = task_meta;
+  if (++l.size > LOCAL_MAX_SIZES[i]) {
+    tls_local_pool.flush(i, LOCAL_MAX_SIZES[i] / 2);
+  }
+}
+
+void TaskMetaPool::trim() {
+  GlobalPool* g = global_pool();
+  TaskMeta* heads[STACK_TYPE_NUM];
+  {
+    std::lock_guard<utils::SpinMutex> lock(g->mu);
+    for (size_t i = 0; i < STACK_TYPE_NUM; ++i) {
+      heads[i] = g->lists[i].head;
+      g->lists[i].head = nullptr;
+      g->lists[i].size = 0;
+    }
+  }
+  for (size_t i = 0; i < STACK_TYPE_NUM; ++i) {
+    while (heads[i] != nullptr) {
+      TaskMeta* next = heads[i]->next;
+      delete heads[i];
+      heads[i] = next;
+    }
+  }
+}
+
+size_t TaskMetaPool::global_size(StackType type) {
+  GlobalPool* g = global_pool();
+  std::lock_guard<utils::SpinMutex> lock(g->mu);
+  return g->lists[static_cast<size_t>(type)].size;
+}
+
+size_t TaskMetaPool::local_max_size(StackType type) {
+  return LOCAL_MAX_SIZES[static_cast<size_t>(type)];
+}
+
+size_t TaskMetaPool::global_max_size(StackType type) {
+  return GLOBAL_MAX_SIZES[static_cast<size_t>(type)];
+}
+
+}  // namespace task_coroutine
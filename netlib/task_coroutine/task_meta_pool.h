@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "task_attr.h"
+
+namespace task_coroutine {
+
+struct TaskMeta;
+
+// TaskMetaPool 复用TaskMeta及其栈内存，稳态下创建/销毁协程不调用malloc/free
+// 1. 按栈类别分别缓存，每个线程一个本地空闲链表，get/put无锁
+// 2. 本地链表超过local_max_size时，一半归还到全局链表；本地为空时从全局批量获取
+// 3. 全局链表超过global_max_size时，多余的TaskMeta直接释放（trim）
+class TaskMetaPool {
+ public:
+  // get 获取一个栈类别为type的空闲TaskMeta，没有时返回nullptr
+  static TaskMeta* get(StackType type);
+
+  // get_batch 批量获取最多n个栈类别为type的空闲TaskMeta，本地不足时只加一次全局锁
+  // 返回值：获取的个数
+  static size_t get_batch(StackType type, TaskMeta** tasks, size_t n);
+
+  // put 归还TaskMeta
+  static void put(TaskMeta* task_meta);
+
+  // trim 释放全局链表中缓存的所有TaskMeta
+  static void trim();
+
+  // global_size 全局链表中缓存的栈类别为type的TaskMeta数量
+  static size_t global_size(StackType type);
+
+  // local_max_size 每个线程本地最多缓存的TaskMeta数量
+  static size_t local_max_size(StackType type);
+
+  // global_max_size 全局最多缓存的TaskMeta数量
+  static size_t global_max_size(StackType type);
+};
+
+}  // namespace task_coroutine
@@ -0,0 +1,109 @@
+#include "task_offload.h"
+
+#include <assert.h>
+
+#include <chrono>
+#include <new>
+#include <thread>
+
+#include "task_group.h"
+
+namespace task_coroutine {
+
+static OffloadPool* g_offload_pool = nullptr;
+
+OffloadPool::OffloadPool(size_t max_threads)
+    : max_threads_(max_threads > 0 ? max_threads : 1),
+      head_(nullptr),
+      tail_(nullptr),
+      njobs_(0),
+      nthreads_(0),
+      nidle_(0) {}
+
+void OffloadPool::init(size_t max_threads) {
+  assert(g_offload_pool == nullptr);
+  g_offload_pool = new (std::nothrow) OffloadPool(max_threads);
+  assert(g_offload_pool != nullptr);
+  utils::g_offload_fn.store(call, std::memory_order_release);
+}
+
+void OffloadPool::call(void (*fn)(void*), void* arg) {
+  TaskMeta* task = TaskGroup::current_task();
+  if (task == nullptr) {
+    // 非工作线程可以阻塞；无栈任务不能换出，直接调用并标记为阻塞调用
+    void* blocking = TaskGroup::enter_blocking();
+    fn(arg);
+    TaskGroup::exit_blocking(blocking);
+    return;
+  }
+  TaskWaiter waiter;
+  waiter.task = task;
+  OffloadJob job{fn, arg, &waiter, nullptr};
+  // 换出之后再入队，线程池完成后wake时当前协程一定已经换出
+  TaskGroup::wait(
+      &waiter,
+      [](void* job) -> void {
+        g_offload_pool->submit(static_cast<OffloadJob*>(job));
+      },
+      &job);
+}
+
+void OffloadPool::submit(OffloadJob* job) {
+  job->next = nullptr;
+  bool spawn = false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (tail_ != nullptr) {
+      tail_->next = job;
+    } else {
+      head_ = job;
+    }
+    tail_ = job;
+    ++njobs_;
+    // 已经通知但还没有醒来的空闲线程仍然计入nidle_，按排队的任务数判断
+    if (njobs_ > nidle_ && nthreads_ < max_threads_) {
+      ++nthreads_;
+      spawn = true;
+    }
+  }
+  if (spawn) {
+    std::thread(&OffloadPool::thread_main, this).detach();
+  } else {
+    cond_.notify_one();
+  }
+}
+
+size_t OffloadPool::threads_num() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return nthreads_;
+}
+
+void OffloadPool::thread_main() {
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    while (head_ == nullptr) {
+      ++nidle_;
+      bool timeout = !cond_.wait_for(
+          lock, std::chrono::milliseconds(IDLE_TIMEOUT_MS),
+          [this]() -> bool { return head_ != nullptr; });
+      --nidle_;
+      if (timeout) {
+        --nthreads_;
+        return;
+      }
+    }
+    OffloadJob* job = head_;
+    head_ = job->next;
+    --njobs_;
+    if (head_ == nullptr) {
+      tail_ = nullptr;
+    }
+    lock.unlock();
+    job->fn(job->arg);
+    // wake之后job所在的协程栈可能被复用，不能再访问job
+    TaskGroup::wake(job->waiter);
+    lock.lock();
+  }
+}
+
+}  // namespace task_coroutine
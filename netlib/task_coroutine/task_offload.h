@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <mutex>
+
+#include "utils/task_hooks.h"
+
+namespace task_coroutine {
+
+struct TaskWaiter;
+
+// 阻塞调用卸载
+// offload(f)在协程中调用时park当前协程，由OffloadPool的线程运行f()，完成后唤醒协程，
+// 协程在工作线程上继续运行并取得返回值。工作线程不被阻塞的系统调用占用
+// 在非工作线程中调用时直接调用f()
+// offload通过utils/task_hooks.h中的g_offload_fn调用，基础模块直接使用utils中的版本
+
+using utils::offload;
+using utils::OffloadResult;
+
+// OffloadJob 卸载到OffloadPool的任务，保存在调用者的栈上
+struct OffloadJob {
+  void (*fn)(void*);
+  void* arg;
+  TaskWaiter* waiter;  // 完成后唤醒
+  OffloadJob* next;
+};
+
+// OffloadPool 运行阻塞调用的弹性线程池，与工作线程分开
+// 1. 排队的任务多于空闲线程时创建新线程，最多max_threads个，超过时排队
+// 2. 线程空闲超过IDLE_TIMEOUT_MS后退出，没有阻塞调用时不占用线程
+class OffloadPool {
+ public:
+  explicit OffloadPool(size_t max_threads);
+
+  OffloadPool(const OffloadPool&) = delete;
+  OffloadPool& operator=(const OffloadPool&) = delete;
+
+  // init 创建全局的OffloadPool并设置utils::g_offload_fn，由TaskControl::init调用
+  static void init(size_t max_threads);
+
+  // call utils::g_offload_fn：协程中park当前协程并把fn(arg)交给线程池，非工作线程中直接调用
+  static void call(void (*fn)(void*), void* arg);
+
+  // submit 任务入队，必要时创建线程
+  void submit(OffloadJob* job);
+
+  size_t threads_num() const;
+
+ private:
+  void thread_main();
+
+  static constexpr int64_t IDLE_TIMEOUT_MS = 10000;
+
+  const size_t max_threads_;
+  mutable std::mutex mu_;
+  std::condition_variable cond_;
+  OffloadJob* head_;  // 先进先出
+  OffloadJob* tail_;
+  size_t njobs_;  // 排队的任务数
+  size_t nthreads_;
+  size_t nidle_;
+};
+
+}  // namespace task_coroutine
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "task_coroutine.h"
+
+namespace task_coroutine {
+
+// 并行算法
+// 1. 递归二分区间，一半创建子协程运行，另一半在当前协程/线程继续划分，叶子区间串行运行，
+//    创建的协程数与工作线程数相关，与元素个数无关
+// 2. 自适应粒度：初始划分约4倍工作线程数个叶子；子协程被其他工作线程窃取运行时，
+//    说明有空闲的工作线程，多划分一次；负载均衡时不再细分
+// 3. 子协程继承当前协程的栈类型和优先级；在非工作线程中调用时当前线程也参与计算
+// 4. grain为叶子区间的最小长度，0表示自动
+// 5. file/line默认为调用并行算法的位置，作为子协程的创建位置，监控线程报告时指向调用者
+// 可调用对象被多个协程并发调用，需要是线程安全的；叶子区间中定期检查时间片（见task_yield.h）
+
+namespace parallel_detail {
+
+// initial_depth 初始的划分次数
+inline int initial_depth() {
+  size_t leaves = TaskControl::get()->task_groups_num() * 4;
+  int depth = 0;
+  while ((static_cast<size_t>(1) << depth) < leaves) {
+    ++depth;
+  }
+  return depth;
+}
+
+// auto_grain 自动的叶子区间最小长度：最多约64倍工作线程数个叶子，至少为min_grain
+inline size_t auto_grain(size_t n, size_t grain, size_t min_grain = 1) {
+  if (grain != 0) {
+    return grain;
+  }
+  return std::max(n / (TaskControl::get()->task_groups_num() * 64), min_grain);
+}
+
+// child_attr 子协程的属性，继承当前协程的栈类型和优先级，创建位置为file:line
+inline TaskAttr child_attr(const char* file, int line) {
+  TaskMeta* task = TaskGroup::current_task();
+  if (task == nullptr) {
+    return TaskAttr(StackType::NORMAL, TaskPriority::INTERACTIVE, file, line);
+  }
+  return TaskAttr(task->stack_type, task->priority, file, line);
+}
+
+// next_depth 子协程的划分次数，被其他工作线程窃取时多划分一次
+inline int next_depth(int depth, TaskGroup* spawner) {
+  return tls_task_group != spawner ? depth + 1 : depth - 1;
+}
+
+// split 划分[begin, end)，叶子区间调用leaf(begin, end)
+template <typename Leaf>
+void split(size_t begin, size_t end, size_t grain, int depth,
+           const TaskAttr& attr, Leaf& leaf) {
+  if (end - begin <= grain || depth <= 0) {
+    leaf(begin, end);
+    return;
+  }
+  size_t mid = begin + (end - begin) / 2;
+  TaskGroup* spawner = tls_task_group;
+  auto right = [mid, end, grain, depth, &attr, &leaf, spawner]() {
+    split(mid, end, grain, next_depth(depth, spawner), attr, leaf);
+  };
+  auto h = spawn(right, attr);
+  split(begin, mid, grain, depth - 1, attr, leaf);
+  if (h.valid()) {
+    h.join();
+  } else {
+    right();  // 内存不足，在当前协程中运行
+  }
+}
+
+// split_reduce 划分[begin, end)，叶子区间的结果为leaf(begin, end)，左右两半的结果用op合并
+template <typename T, typename Leaf, typename Op>
+T split_reduce(size_t begin, size_t end, size_t grain, int depth,
+               const TaskAttr& attr, Leaf& leaf, Op& op) {
+  if (end - begin <= grain || depth <= 0) {
+    return leaf(begin, end);
+  }
+  size_t mid = begin + (end - begin) / 2;
+  TaskGroup* spawner = tls_task_group;
+  auto right = [mid, end, grain, depth, &attr, &leaf, &op, spawner]() -> T {
+    return split_reduce<T>(mid, end, grain, next_depth(depth, spawner), attr,
+                           leaf, op);
+  };
+  auto h = spawn(right, attr);
+  T left = split_reduce<T>(begin, mid, grain, depth - 1, attr, leaf, op);
+  return op(std::move(left), h.valid() ? h.join() : right());
+}
+
+// split_sort 快速排序，三数取中、三路划分，两侧并行排序，
+// 区间不超过grain或划分次数用完时使用std::sort
+template <typename RandomIt, typename Compare>
+void split_sort(RandomIt first, RandomIt last, size_t grain, int depth,
+                const TaskAttr& attr, Compare& comp) {
+  size_t n = static_cast<size_t>(last - first);
+  if (n <= grain || depth <= 0) {
+    std::sort(first, last, comp);
+    return;
+  }
+  RandomIt a = first, b = first + n / 2, c = last - 1;
+  if (comp(*b, *a)) {
+    std::swap(a, b);
+  }
+  if (comp(*c, *b)) {
+    b = comp(*c, *a) ? a : c;
+  }
+  typename std::iterator_traits<RandomIt>::value_type pivot = *b;
+  RandomIt m1 = std::partition(
+      first, last, [&comp, &pivot](const auto& x) { return comp(x, pivot); });
+  RandomIt m2 = std::partition(
+      m1, last, [&comp, &pivot](const auto& x) { return !comp(pivot, x); });
+  TaskGroup* spawner = tls_task_group;
+  auto right = [m2, last, grain, depth, &attr, &comp, spawner]() {
+    split_sort(m2, last, grain, next_depth(depth, spawner), attr, comp);
+  };
+  auto h = spawn(right, attr);
+  split_sort(first, m1, grain, depth - 1, attr, comp);
+  if (h.valid()) {
+    h.join();
+  } else {
+    right();  // 内存不足，在当前协程中运行
+  }
+}
+
+}  // namespace parallel_detail
+
+// parallel_for 对[begin, end)中的每个下标i调用f(i)
+// 例：parallel_for(0, v.size(), [&v](size_t i) { v[i] *= 2; });
+template <typename F>
+void parallel_for(size_t begin, size_t end, F&& f, size_t grain = 0,
+                  const char* file = __builtin_FILE(),
+                  int line = __builtin_LINE()) {
+  if (begin >= end) {
+    return;
+  }
+  auto leaf = [&f](size_t b, size_t e) {
+    YieldCounter counter;
+    for (size_t i = b; i < e; ++i) {
+      counter.tick();
+      f(i);
+    }
+  };
+  TaskAttr attr = parallel_detail::child_attr(file, line);
+  parallel_detail::split(begin, end,
+                         parallel_detail::auto_grain(end - begin, grain),
+                         parallel_detail::initial_depth(), attr, leaf);
+}
+
+// parallel_for_each 对随机访问区间[first, last)中的每个元素调用f(*it)
+template <typename RandomIt, typename F>
+void parallel_for_each(RandomIt first, RandomIt last, F&& f, size_t grain = 0,
+                       const char* file = __builtin_FILE(),
+                       int line = __builtin_LINE()) {
+  parallel_for(
+      0, static_cast<size_t>(last - first),
+      [first, &f](size_t i) { f(first[i]); }, grain, file, line);
+}
+
+// parallel_transform d_first[i] = f(first[i])，返回输出区间的末尾
+template <typename RandomIt, typename OutputIt, typename F>
+OutputIt parallel_transform(RandomIt first, RandomIt last, OutputIt d_first,
+                            F&& f, size_t grain = 0,
+                            const char* file = __builtin_FILE(),
+                            int line = __builtin_LINE()) {
+  size_t n = static_cast<size_t>(last - first);
+  parallel_for(
+      0, n, [first, d_first, &f](size_t i) { d_first[i] = f(first[i]); },
+      grain, file, line);
+  return d_first + n;
+}
+
+// parallel_reduce 返回identity与[begin, end)中每个map(i)用op合并的结果
+// op需要满足结合律，identity为op的单位元（每个叶子区间从identity开始合并）
+// 例：auto sum = parallel_reduce(0, v.size(), 0L, [&v](size_t i) { return v[i]; },
+//                               std::plus<long>());
+template <typename T, typename Map, typename Op>
+T parallel_reduce(size_t begin, size_t end, T identity, Map&& map, Op&& op,
+                  size_t grain = 0, const char* file = __builtin_FILE(),
+                  int line = __builtin_LINE()) {
+  if (begin >= end) {
+    return identity;
+  }
+  auto leaf = [&identity, &map, &op](size_t b, size_t e) -> T {
+    YieldCounter counter;
+    T acc = identity;
+    for (size_t i = b; i < e; ++i) {
+      counter.tick();
+      acc = op(std::move(acc), map(i));
+    }
+    return acc;
+  };
+  TaskAttr attr = parallel_detail::child_attr(file, line);
+  return parallel_detail::split_reduce<T>(
+      begin, end, parallel_detail::auto_grain(end - begin, grain),
+      parallel_detail::initial_depth(), attr, leaf, op);
+}
+
+// parallel_sort 并行排序随机访问区间[first, last)，不稳定，元素需要可以拷贝（作为pivot）
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp = Compare(),
+                   size_t grain = 0, const char* file = __builtin_FILE(),
+                   int line = __builtin_LINE()) {
+  size_t n = static_cast<size_t>(last - first);
+  // 快速排序的划分不均匀，多划分两次；叶子区间太小时创建协程的开销大于排序
+  TaskAttr attr = parallel_detail::child_attr(file, line);
+  parallel_detail::split_sort(first, last,
+                              parallel_detail::auto_grain(n, grain, 4096),
+                              parallel_detail::initial_depth() + 2, attr, comp);
+}
+
+}  // namespace task_coroutine
@@ -1,24 +1,49 @@
 #pragma once
 
-#include <condition_variable>
-#include <mutex>
+#include "task_futex.h"
+#include "task_timer.h"
 
 namespace task_coroutine {
 
+// ParkingLot 每个工作线程一个，基于futex的park/unpark
+// unpark发放一个许可，park消耗许可，没有许可时阻塞，许可不累加
+// 先unpark后park时park立即返回，不会丢失唤醒
 class ParkingLot {
  public:
-  ParkingLot() {}
+  ParkingLot() : permit_(0) {}
 
-  void notify() const { cond_.notify_all(); }
+  ParkingLot(const ParkingLot&) = delete;
+  ParkingLot& operator=(const ParkingLot&) = delete;
 
-  void wait() const {
-    std::unique_lock<std::mutex> lock(mu_);
-    cond_.wait(lock);
+  // park 只能由所属工作线程调用
+  void park() {
+    while (permit_.exchange(0, std::memory_order_acquire) == 0) {
+      futex_wait(&permit_, 0);
+    }
+  }
+
+  // park_until 最多park到deadline_ns（monotonic_ns），返回值：false表示超时，没有消耗许可
+  bool park_until(int64_t deadline_ns) {
+    while (permit_.exchange(0, std::memory_order_acquire) == 0) {
+      int64_t timeout_ns = deadline_ns - monotonic_ns();
+      if (timeout_ns <= 0) {
+        return false;
+      }
+      struct timespec ts = to_timespec(timeout_ns);
+      futex_wait(&permit_, 0, &ts);
+    }
+    return true;
+  }
+
+  // unpark 任意线程调用
+  void unpark() {
+    if (permit_.exchange(1, std::memory_order_release) == 0) {
+      futex_wake(&permit_, 1);
+    }
   }
 
  private:
-  mutable std::mutex mu_;
-  mutable std::condition_variable cond_;
+  std::atomic<uint32_t> permit_;
 };
 
-}  // namespace task_coroutine
\ No newline at end of file
+}  // namespace task_coroutine
@@ -0,0 +1,284 @@
+#include "task_registry.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+
+#include "task_control.h"
+#include "task_group.h"
+#include "task_meta.h"
+#include "task_timer.h"
+
+namespace task_coroutine {
+
+// 回溯的最大帧数
+static constexpr size_t MAX_BACKTRACE_FRAMES = 64;
+
+// tasks每次持有注册表的锁复制的协程数
+static constexpr size_t TASKS_CHUNK = 256;
+
+namespace {
+
+// Registry 存活的TaskMeta的双向链表
+// tasks分段遍历，两段之间释放锁，cursor为下一段的开始，移出cursor时后移
+struct Registry {
+  std::mutex mu;
+  TaskMeta* head = nullptr;
+  std::mutex scan_mu;  // 同一时间只有一个tasks遍历
+  TaskMeta* cursor = nullptr;
+};
+
+Registry g_registry;
+
+#ifdef TASK_COROUTINE_REGISTRY
+// group_index task_group在TaskControl中的下标，临时线程的task_group返回-1
+int group_index(const TaskGroup* g) {
+  TaskControl* tc = g_task_control.load(std::memory_order_acquire);
+  if (g == nullptr || tc == nullptr) {
+    return -1;
+  }
+  for (size_t i = 0; i < tc->task_groups_num(); ++i) {
+    if (tc->task_group(i) == g) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+#endif
+
+// print_frame 打印一帧：地址、符号+偏移、所在的模块+偏移（可以用addr2line -e解析）
+void print_frame(FILE* out, size_t i, void* pc) {
+  Dl_info info;
+  if (dladdr(pc, &info) == 0 || info.dli_fname == nullptr) {
+    fprintf(out, "    #%lu %p\n", i, pc);
+    return;
+  }
+  uintptr_t addr = reinterpret_cast<uintptr_t>(pc);
+  char* demangled = nullptr;
+  if (info.dli_sname != nullptr) {
+    int status = 0;
+    demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    fprintf(out, "    #%lu %p %s+0x%lx", i, pc,
+            demangled != nullptr ? demangled : info.dli_sname,
+            addr - reinterpret_cast<uintptr_t>(info.dli_saddr));
+    free(demangled);
+  } else {
+    fprintf(out, "    #%lu %p", i, pc);
+  }
+  fprintf(out, " (%s+0x%lx)\n", info.dli_fname,
+          addr - reinterpret_cast<uintptr_t>(info.dli_fbase));
+}
+
+}  // namespace
+
+const char* task_run_state_name(TaskRunState state) {
+  switch (state) {
+    case TaskRunState::FREE:
+      return "FREE";
+    case TaskRunState::CREATED:
+      return "CREATED";
+    case TaskRunState::RUNNING:
+      return "RUNNING";
+    case TaskRunState::READY:
+      return "READY";
+    case TaskRunState::SUSPENDED:
+      return "SUSPENDED";
+    case TaskRunState::DONE:
+      return "DONE";
+  }
+  return "UNKNOWN";
+}
+
+#ifdef TASK_COROUTINE_REGISTRY
+void TaskRegistry::add(TaskMeta* task_meta) {
+  std::lock_guard<std::mutex> lock(g_registry.mu);
+  task_meta->record.prev = nullptr;
+  task_meta->record.next = g_registry.head;
+  if (g_registry.head != nullptr) {
+    g_registry.head->record.prev = task_meta;
+  }
+  g_registry.head = task_meta;
+}
+
+void TaskRegistry::remove(TaskMeta* task_meta) {
+  std::lock_guard<std::mutex> lock(g_registry.mu);
+  TaskRecord& r = task_meta->record;
+  if (r.prev != nullptr) {
+    r.prev->record.next = r.next;
+  } else {
+    g_registry.head = r.next;
+  }
+  if (r.next != nullptr) {
+    r.next->record.prev = r.prev;
+  }
+  if (g_registry.cursor == task_meta) {
+    g_registry.cursor = r.next;
+  }
+  r.prev = r.next = nullptr;
+}
+#endif
+
+// 保存的上下文布局见task_context.cpp：对齐 r12 r13 r14 r15 rbx rbp 返回地址
+// 协程可能同时在其他工作线程上恢复运行，栈上的内容随时变化，每一帧都检查范围，
+// 帧指针必须递增，最多max帧
+__attribute__((no_sanitize("address"))) size_t TaskRegistry::backtrace(
+    void* memory, StackType type, const void* stack, void** frames,
+    size_t max) {
+  uintptr_t bottom = reinterpret_cast<uintptr_t>(memory) + stack_guard_size(type);
+  uintptr_t top = reinterpret_cast<uintptr_t>(stack_top(memory, type));
+  uintptr_t sp = reinterpret_cast<uintptr_t>(stack);
+  if (max == 0 || sp < bottom || sp + 8 * 8 > top || sp % 8 != 0) {
+    return 0;
+  }
+  void** ctx = reinterpret_cast<void**>(sp);
+  size_t n = 0;
+  frames[n++] = ctx[7];
+  uintptr_t fp = reinterpret_cast<uintptr_t>(ctx[6]);
+  uintptr_t prev = sp;
+  while (n < max && fp > prev && fp + 16 <= top && fp % 8 == 0) {
+    void** frame = reinterpret_cast<void**>(fp);
+    if (frame[1] == nullptr) {
+      break;
+    }
+    frames[n++] = frame[1];
+    prev = fp;
+    fp = reinterpret_cast<uintptr_t>(frame[0]);
+  }
+  return n;
+}
+
+// 栈从高地址向低地址增长，从栈的最低地址开始找第一个非零字；没有物理页的部分没有被使用过
+// （或已经被trim_stack释放），用mincore跳过，不访问这些页
+__attribute__((no_sanitize("address"))) size_t TaskRegistry::stack_used(
+    void* memory, StackType type) {
+  char* bottom = static_cast<char*>(memory) + stack_guard_size(type);
+  char* top = static_cast<char*>(stack_top(memory, type));
+  size_t page = stack_guard_size();
+  size_t npages = (top - bottom + page - 1) / page;
+  std::vector<unsigned char> resident(npages);
+  bool check_resident = mincore(bottom, top - bottom, resident.data()) == 0;
+  for (size_t i = 0; i < npages; ++i) {
+    if (check_resident && (resident[i] & 1) == 0) {
+      continue;
+    }
+    const uint64_t* p = reinterpret_cast<const uint64_t*>(bottom + i * page);
+    const uint64_t* end = reinterpret_cast<const uint64_t*>(
+        std::min(bottom + (i + 1) * page, top));
+    for (; p < end; ++p) {
+      if (*p != 0) {
+        return top - reinterpret_cast<const char*>(p);
+      }
+    }
+  }
+  return 0;
+}
+
+// 持有锁时只复制TaskMeta的字段，每段最多TASKS_CHUNK个，读栈在释放锁之后：
+// 栈来自StackSlabs，释放后不会munmap，协程在此期间退出时读到的是复用或已经清零的栈，
+// 只是结果不准确
+std::vector<TaskInfo> TaskRegistry::tasks(bool backtrace) {
+  std::vector<TaskInfo> infos;
+#ifdef TASK_COROUTINE_REGISTRY
+  struct StackRef {
+    void* memory;
+    const void* sp;  // 换出时保存的栈指针
+  };
+  std::vector<StackRef> stacks;
+  void* frames[MAX_BACKTRACE_FRAMES];
+  std::lock_guard<std::mutex> scan_lock(g_registry.scan_mu);
+  std::unique_lock<std::mutex> lock(g_registry.mu);
+  g_registry.cursor = g_registry.head;
+  while (g_registry.cursor != nullptr) {
+    size_t begin = infos.size();
+    stacks.clear();
+    while (g_registry.cursor != nullptr && stacks.size() < TASKS_CHUNK) {
+      TaskMeta* t = g_registry.cursor;
+      g_registry.cursor = t->record.next;
+      TaskRunState state = t->record.state.load(std::memory_order_relaxed);
+      if (state == TaskRunState::FREE) {
+        continue;
+      }
+      size_t meta_state = t->state.load(std::memory_order_relaxed);
+      if (meta_state & TaskMeta::state_fn_done) {
+        if (meta_state & TaskMeta::state_coroutine_destructor) {
+          continue;  // 已经join/析构，等待工作线程回收
+        }
+        state = TaskRunState::DONE;
+      }
+      TaskInfo info;
+      info.id = t->record.id;
+      info.state = state;
+      info.spawn_file = t->spawn_file;
+      info.spawn_line = t->spawn_line;
+      info.group = group_index(t->group);
+      info.last_run_ns = t->record.last_run_ns.load(std::memory_order_relaxed);
+      info.stack_type = t->stack_type;
+      info.stack_size = stack_size(t->stack_type);
+      info.stack_used = 0;
+      infos.push_back(std::move(info));
+      stacks.push_back(StackRef{t->memory, t->stack});
+    }
+    lock.unlock();
+    for (size_t i = 0; i < stacks.size(); ++i) {
+      TaskInfo& info = infos[begin + i];
+      info.stack_used = stack_used(stacks[i].memory, info.stack_type);
+      if (backtrace && (info.state == TaskRunState::READY ||
+                        info.state == TaskRunState::SUSPENDED)) {
+        size_t n = TaskRegistry::backtrace(stacks[i].memory, info.stack_type,
+                                           stacks[i].sp, frames,
+                                           MAX_BACKTRACE_FRAMES);
+        info.backtrace.assign(frames, frames + n);
+      }
+    }
+    lock.lock();
+  }
+#endif
+  return infos;
+}
+
+void TaskRegistry::dump(FILE* out) {
+  std::vector<TaskInfo> infos = tasks();
+  // 没有运行过的排在最前，之后按上次运行的时间从早到晚
+  std::stable_sort(infos.begin(), infos.end(),
+                   [](const TaskInfo& a, const TaskInfo& b) {
+                     return a.last_run_ns < b.last_run_ns;
+                   });
+  size_t counts[static_cast<size_t>(TaskRunState::DONE) + 1] = {0};
+  for (const TaskInfo& info : infos) {
+    ++counts[static_cast<size_t>(info.state)];
+  }
+  fprintf(out,
+          "task_coroutine: %lu tasks, created = %lu, running = %lu, "
+          "ready = %lu, suspended = %lu, done = %lu\n",
+          infos.size(), counts[static_cast<size_t>(TaskRunState::CREATED)],
+          counts[static_cast<size_t>(TaskRunState::RUNNING)],
+          counts[static_cast<size_t>(TaskRunState::READY)],
+          counts[static_cast<size_t>(TaskRunState::SUSPENDED)],
+          counts[static_cast<size_t>(TaskRunState::DONE)]);
+  int64_t now = monotonic_ns();
+  for (const TaskInfo& info : infos) {
+    fprintf(out, "  task %lu %s", info.id, task_run_state_name(info.state));
+    if (info.group >= 0) {
+      fprintf(out, " task_group = %d", info.group);
+    }
+    if (info.last_run_ns > 0) {
+      fprintf(out, " last_run = %ldms ago",
+              static_cast<long>((now - info.last_run_ns) / 1000000));
+    }
+    if (info.spawn_file != nullptr) {
+      fprintf(out, " spawned at %s:%d", info.spawn_file, info.spawn_line);
+    }
+    fprintf(out, " stack = %lu/%lu\n", info.stack_used, info.stack_size);
+    for (size_t i = 0; i < info.backtrace.size(); ++i) {
+      print_frame(out, i, info.backtrace[i]);
+    }
+  }
+  fflush(out);
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "define.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+#include <vector>
+
+#include "task_attr.h"
+
+namespace task_coroutine {
+
+struct TaskMeta;
+
+// 协程注册表：登记所有存活的协程，服务卡住时查看有哪些协程、停在哪里、等了多久
+// 1. 分配TaskMeta时加入、析构时移出，从TaskMetaPool复用时不加锁；
+//    创建、切换、换出、唤醒时只用relaxed store更新TaskMeta中的TaskRecord
+// 2. 运行时间使用CLOCK_MONOTONIC_COARSE，由vDSO读取，不进入内核，精度为一个时钟中断（通常1~4ms）
+// 3. tasks/dump在任意线程调用，分段持有注册表的锁复制TaskMeta的字段，读栈时不持有锁，
+//    不阻塞协程的创建和回收；各字段在协程运行的同时读取，不是一致的快照
+// 4. 换出的协程从保存的上下文沿rbp链回溯，完整的回溯需要-fno-omit-frame-pointer编译，
+//    否则通常只有换出点；每一帧都检查在协程栈的范围内，不会访问栈以外的内存
+// 默认开启，定义TASK_COROUTINE_NO_REGISTRY关闭（CMake选项NETLIB_TASK_REGISTRY），见define.h
+
+// TaskRunState 协程的运行状态
+enum class TaskRunState : uint8_t {
+  FREE = 0,   // 在TaskMetaPool中，不是存活的协程
+  CREATED,    // 已创建，还没有开始运行
+  RUNNING,    // 正在工作线程上运行
+  READY,      // 在调度队列中等待运行（yield或被唤醒）
+  SUSPENDED,  // 换出等待，例如锁、信号量、channel、join、sleep
+  DONE,       // 运行完成，Coroutine/JoinHandle还没有join或析构
+};
+
+// task_run_state_name 状态的名称
+const char* task_run_state_name(TaskRunState state);
+
+// TaskRecord TaskMeta中注册表使用的字段
+struct TaskRecord {
+  size_t id = 0;  // 每次创建协程分配，从1开始，同一线程创建的协程id递增
+  std::atomic<TaskRunState> state{TaskRunState::FREE};
+  std::atomic<int64_t> last_run_ns{0};  // 上次开始运行的时间（TaskRegistry::now_ns），0表示没有运行过
+  TaskMeta* prev = nullptr;  // 注册表链表，由注册表的锁保护
+  TaskMeta* next = nullptr;
+};
+
+// TaskInfo 一个存活协程的信息
+struct TaskInfo {
+  size_t id;
+  TaskRunState state;
+  const char* spawn_file;  // 创建协程的位置，见TaskAttr
+  int spawn_line;
+  int group;  // 上次运行所在的task_group下标，-1表示没有运行过或在临时线程上运行
+  int64_t last_run_ns;  // 上次开始运行的时间，0表示没有运行过
+  StackType stack_type;
+  size_t stack_size;
+  size_t stack_used;  // 栈的最高水位：从栈顶到栈上最低的非零字节，栈复用时包括之前的协程
+  std::vector<void*> backtrace;  // READY/SUSPENDED的协程的回溯，第一个为换出点
+};
+
+class TaskRegistry {
+ public:
+  // tasks 所有存活的协程，backtrace为false时不回溯；关闭注册表时为空
+  static std::vector<TaskInfo> tasks(bool backtrace = true);
+
+  // dump 打印所有存活的协程及其回溯，按等待时间从长到短排序
+  static void dump(FILE* out = stderr);
+
+  // now_ns 粗粒度时钟，与monotonic_ns同一时间基准，不会超过monotonic_ns
+  static int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // add/remove 分配、析构TaskMeta时加入、移出注册表
+  static void add(TaskMeta* task_meta);
+  static void remove(TaskMeta* task_meta);
+
+  // next_id 分配协程id，每个线程一次从全局计数器取一批
+  static size_t next_id() {
+    static thread_local size_t tls_next = 0;
+    static thread_local size_t tls_end = 0;
+    if (tls_next == tls_end) {
+      tls_next = next_id_.fetch_add(ID_BATCH, std::memory_order_relaxed);
+      tls_end = tls_next + ID_BATCH;
+    }
+    return tls_next++;
+  }
+
+  // backtrace 从换出的协程保存的上下文回溯，stack为换出时保存的栈指针，最多max帧，返回帧数
+  static size_t backtrace(void* memory, StackType type, const void* stack,
+                          void** frames, size_t max);
+
+  // stack_used 栈的最高水位，跳过没有物理页的部分
+  static size_t stack_used(void* memory, StackType type);
+
+ private:
+  static constexpr size_t ID_BATCH = 1024;
+
+  inline static std::atomic<size_t> next_id_{1};
+};
+
+}  // namespace task_coroutine
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "define.h"
+
+#include <stddef.h>
+
+#ifdef TASK_COROUTINE_ASAN
+#include <pthread.h>
+#include <sanitizer/asan_interface.h>
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+#ifdef TASK_COROUTINE_TSAN
+#include <sanitizer/tsan_interface.h>
+#endif
+
+#include "task_stack.h"
+
+namespace task_coroutine {
+
+// 切换协程时通知sanitizer，使用-fsanitize=address/thread编译时开启（CMake选项NETLIB_SANITIZE），
+// 否则都是空函数
+// ASan：每个协程栈是一个fiber，切换前登记目标栈的范围，切换回来后完成切换；
+//       运行完成的协程不会再切换回来，fake_stack传nullptr释放它的fake stack
+// TSan：每个TaskMeta有一个fiber，主函数使用线程原来的fiber
+
+// sanitizer_current_fiber 当前线程正在运行的fiber，用于主函数的TaskMeta
+inline void* sanitizer_current_fiber() {
+#ifdef TASK_COROUTINE_TSAN
+  return __tsan_get_current_fiber();
+#else
+  return nullptr;
+#endif
+}
+
+// sanitizer_create_fiber 为协程创建fiber
+inline void* sanitizer_create_fiber() {
+#ifdef TASK_COROUTINE_TSAN
+  return __tsan_create_fiber(0);
+#else
+  return nullptr;
+#endif
+}
+
+// sanitizer_destroy_fiber 销毁sanitizer_create_fiber创建的fiber，不能是当前的fiber
+inline void sanitizer_destroy_fiber(void* fiber) {
+#ifdef TASK_COROUTINE_TSAN
+  if (fiber != nullptr) {
+    __tsan_destroy_fiber(fiber);
+  }
+#endif
+}
+
+// sanitizer_unpoison 清除[p, p + n)上残留的ASan标记，复用的栈上可能有没有正常返回的栈帧留下的标记
+inline void sanitizer_unpoison(const void* p, size_t n) {
+#ifdef TASK_COROUTINE_ASAN
+  __asan_unpoison_memory_region(p, n);
+#endif
+}
+
+// sanitizer_start_switch 切换到栈memory（主函数为nullptr，使用线程的栈）、fiber之前调用
+// fake_stack保存当前协程的fake stack，当前协程运行完成、不会再切换回来时为nullptr
+inline void sanitizer_start_switch(void** fake_stack, void* memory,
+                                   StackType type, void* fiber) {
+#ifdef TASK_COROUTINE_ASAN
+  const void* bottom;
+  size_t size;
+  if (memory == nullptr) {
+    static thread_local void* tls_bottom = nullptr;
+    static thread_local size_t tls_size = 0;
+    if (tls_bottom == nullptr) {
+      pthread_attr_t attr;
+      pthread_getattr_np(pthread_self(), &attr);
+      pthread_attr_getstack(&attr, &tls_bottom, &tls_size);
+      pthread_attr_destroy(&attr);
+    }
+    bottom = tls_bottom;
+    size = tls_size;
+  } else {
+    bottom = static_cast<char*>(memory) + stack_guard_size(type);
+    size = stack_size(type);
+  }
+  __sanitizer_start_switch_fiber(fake_stack, bottom, size);
+#endif
+#ifdef TASK_COROUTINE_TSAN
+  __tsan_switch_to_fiber(fiber, 0);
+#endif
+}
+
+// sanitizer_finish_switch 切换回来后调用，新协程在入口处以nullptr调用
+inline void sanitizer_finish_switch(void* fake_stack) {
+#ifdef TASK_COROUTINE_ASAN
+  __sanitizer_finish_switch_fiber(fake_stack, nullptr, nullptr);
+#endif
+}
+
+}  // namespace task_coroutine
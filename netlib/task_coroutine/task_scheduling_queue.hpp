@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
@@ -11,20 +12,35 @@ namespace task_coroutine {
 template <typename T>
 class TaskSchedulingQueue {
  public:
-  TaskSchedulingQueue() {}
+  TaskSchedulingQueue() : size_(0) {}
 
   void push(const T& value) {
     std::lock_guard<std::mutex> lock(mu_);
     sq_.push(value);
+    size_.store(sq_.size(), std::memory_order_relaxed);
     cond_.notify_one();
   }
 
   void push(T&& value) {
     std::lock_guard<std::mutex> lock(mu_);
     sq_.push(std::forward<T>(value));
+    size_.store(sq_.size(), std::memory_order_relaxed);
     cond_.notify_one();
   }
 
+  // push_batch 一次加锁放入n个元素
+  void push_batch(const T* values, size_t n) {
+    if (n == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    for (size_t i = 0; i < n; ++i) {
+      sq_.push(values[i]);
+    }
+    size_.store(sq_.size(), std::memory_order_relaxed);
+    cond_.notify_all();
+  }
+
   T pop() {
     std::unique_lock<std::mutex> lock(mu_);
     while (sq_.empty()) {
@@ -32,23 +48,35 @@ class TaskSchedulingQueue {
     }
     T val = std::move(sq_.front());
     sq_.pop();
+    size_.store(sq_.size(), std::memory_order_relaxed);
     return val;
   }
 
   bool try_pop(T& ret) {
+    if (empty()) {
+      return false;  // 空队列不加锁，轮询多个队列时开销小
+    }
     std::lock_guard<std::mutex> lock(mu_);
     if (sq_.empty()) {
       return false;
     }
     ret = std::move(sq_.front());
     sq_.pop();
+    size_.store(sq_.size(), std::memory_order_relaxed);
     return true;
   }
 
+  // empty 不加锁读取近似的大小，与入队之间的同步由调用方的内存屏障保证
+  bool empty() const { return size_.load(std::memory_order_relaxed) == 0; }
+
+  // size 不加锁读取近似的大小，用于统计
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
  private:
   std::mutex mu_;
   std::condition_variable cond_;
   std::queue<T> sq_;
+  std::atomic<size_t> size_;  // sq_的大小，在mu_保护下修改
 };
 
 }  // namespace task_coroutine
@@ -0,0 +1,48 @@
+#include "task_scope.h"
+
+#include <mutex>
+
+#include "task_group.h"
+
+namespace task_coroutine {
+
+int TaskScope::join() {
+  // 子协程可能继续向作用域创建子协程，直到没有尚未join的子协程为止
+  for (;;) {
+    std::vector<Coroutine> children;
+    {
+      std::lock_guard<utils::SpinMutex> lock(mu_);
+      children.swap(children_);
+    }
+    if (children.empty()) {
+      break;
+    }
+    for (auto& c : children) {
+      c.join();
+    }
+  }
+  return error();
+}
+
+void TaskScope::fail(int err) {
+  assert(err != 0);
+  int expected = 0;
+  error_.compare_exchange_strong(expected, err, std::memory_order_acq_rel);
+  cancel();
+}
+
+bool TaskScope::cancelled() const {
+  for (const TaskScope* s = this; s != nullptr; s = s->parent_) {
+    if (s->cancelled_.load(std::memory_order_acquire)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TaskScope* TaskScope::current() {
+  TaskMeta* task = TaskGroup::current_task();
+  return task != nullptr ? task->scope : nullptr;
+}
+
+}  // namespace task_coroutine
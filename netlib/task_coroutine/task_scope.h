@@ -0,0 +1,119 @@
+#pragma once
+
+#include <assert.h>
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "task_callable.h"
+#include "task_coroutine.h"
+#include "utils/spin_mutex.h"
+
+namespace task_coroutine {
+
+// TaskScope 结构化并发：作用域拥有其中创建的子协程
+// 1. spawn创建的子协程在join或析构时全部完成，子协程不会比作用域活得更久
+// 2. 子协程返回int时非0表示失败，记录第一个失败的错误码并取消作用域，join返回该错误码
+// 3. 取消是协作式的：取消后不再创建新的子协程，已经运行的子协程通过cancelled()/
+//    current_cancelled()检查后尽早返回；取消会传递给在子协程中创建的嵌套作用域
+// 例：
+//   TaskScope scope;
+//   for (auto& shard : shards) {
+//     scope.spawn([&shard]() -> int { return query(shard); });
+//   }
+//   int err = scope.join();  // 任意一个失败时其余的子协程尽早返回
+class TaskScope {
+ public:
+  // 在TaskScope的子协程中创建时，外层作用域取消时这个作用域也视为取消
+  TaskScope() : parent_(current()), cancelled_(false), error_(0) {}
+
+  TaskScope(const TaskScope&) = delete;
+  TaskScope& operator=(const TaskScope&) = delete;
+
+  // 析构时等待所有子协程完成，需要提前结束时先调用cancel
+  ~TaskScope() { join(); }
+
+  // spawn 创建运行f()的子协程，f的返回值为void或int（非0表示失败）
+  // 作用域已经取消或内存不足时不创建，返回false，f没有被移动。可以在子协程中向所属的作用域继续创建
+  template <typename F>
+  bool spawn(F&& f, const TaskAttr& attr = TaskAttr()) {
+    using R = TaskCallableResult<F>;
+    static_assert(std::is_void<R>::value || std::is_same<R, int>::value,
+                  "TaskScope child must return void or int");
+    if (cancelled()) {
+      return false;
+    }
+    TaskMeta* task =
+        new_callable_task<ScopeChild<typename std::decay<F>::type>, void>(
+            attr, this, std::forward<F>(f));
+    if (task == nullptr) {
+      return false;
+    }
+    task->scope = this;
+    {
+      std::lock_guard<utils::SpinMutex> lock(mu_);
+      children_.push_back(Coroutine(task));
+    }
+    TaskGroup::start_task(task);
+    return true;
+  }
+
+  // join 等待所有子协程（包括join期间新创建的）完成，返回第一个失败的错误码，0表示都成功
+  // 只能由创建作用域的协程/线程调用
+  int join();
+
+  // cancel 取消作用域，返回值：是否是第一次取消
+  // 用于扇出后只需要第一个结果的场景：得到结果的子协程cancel成功时写入结果，其余子协程尽早返回
+  bool cancel() { return !cancelled_.exchange(true, std::memory_order_acq_rel); }
+
+  // fail 记录失败的错误码（只保留第一个）并取消作用域，err不能为0
+  void fail(int err);
+
+  // cancelled 作用域或外层作用域是否已经取消
+  bool cancelled() const;
+
+  // error 第一个失败的错误码，0表示还没有失败
+  int error() const { return error_.load(std::memory_order_acquire); }
+
+  // current 当前协程所属的作用域（由TaskScope::spawn创建时），否则为nullptr
+  static TaskScope* current();
+
+  // current_cancelled 当前协程所属的作用域是否已经取消，长时间运行的子协程定期检查
+  static bool current_cancelled() {
+    TaskScope* scope = current();
+    return scope != nullptr && scope->cancelled();
+  }
+
+ private:
+  // ScopeChild 子协程运行的可调用对象，返回非0时记录失败
+  template <typename F>
+  struct ScopeChild {
+    template <typename G>
+    ScopeChild(TaskScope* scope_, G&& g)
+        : scope(scope_), f(std::forward<G>(g)) {}
+
+    void operator()() {
+      if constexpr (std::is_void<TaskCallableResult<F>>::value) {
+        f();
+      } else {
+        int err = f();
+        if (err != 0) {
+          scope->fail(err);
+        }
+      }
+    }
+
+    TaskScope* scope;
+    F f;
+  };
+
+  TaskScope* const parent_;  // 外层作用域，比当前作用域活得更久
+  std::atomic<bool> cancelled_;
+  std::atomic<int> error_;
+  utils::SpinMutex mu_;
+  std::vector<Coroutine> children_;  // 尚未join的子协程
+};
+
+}  // namespace task_coroutine
@@ -0,0 +1,176 @@
+#include "task_stack.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "task_sanitizer.h"
+
+namespace task_coroutine {
+
+static constexpr size_t STACK_SIZES[STACK_TYPE_NUM] = {
+    1024 * 8,     // SMALL
+    1024 * 64,    // NORMAL
+    1024 * 1024,  // LARGE
+    1024 * 64,    // COMPACT
+};
+
+// 每个slab的大小，按栈类别的栈大小（包括保护页）切分
+static constexpr size_t STACK_SLAB_SIZE = 1024 * 1024 * 16;
+
+// trim_stack在保留区域底部写入的标记，每16字节一个，位于返回地址所在的位置（x86-64下
+// call之后的栈指针模16余8）。再次换出之前调用到更深处时，栈帧的返回地址会覆盖其中之一，
+// 除非单个栈帧大于标记区域；漏掉时只是少释放物理页
+static constexpr size_t TRIM_STACK_MARKS = 64;  // 1KB
+static constexpr uint64_t TRIM_STACK_MARK = 0x7472696d5f6d726bULL;
+
+// trim_stack保留的sp以下的字节数，标记区域之上留出1KB给换出时的调用
+static constexpr size_t TRIM_STACK_MARGIN = TRIM_STACK_MARKS * 16 + 1024;
+
+namespace {
+
+// guarded_stacks_limit 有保护页的栈的数量上限，为vm.max_map_count的1/4：
+// 每个有保护页的栈占两个VMA，给线程栈、malloc、动态库等留出一半
+size_t guarded_stacks_limit() {
+  size_t max_map_count = 65530;  // 内核默认值
+  FILE* f = fopen("/proc/sys/vm/max_map_count", "r");
+  if (f != nullptr) {
+    if (fscanf(f, "%lu", &max_map_count) != 1) {
+      max_map_count = 65530;
+    }
+    fclose(f);
+  }
+  return max_map_count / 4;
+}
+
+std::atomic<size_t> g_guarded_stacks(0);  // 已经设置保护页的栈的数量
+
+// StackSlabs 一个栈类别的分配器
+// slab一次mmap，按栈大小（包括保护页）切分，不归还；释放的栈先释放物理页再放入空闲列表复用
+// 第一次切分出的栈设置保护页，超过guarded_stacks_limit或mprotect失败（VMA已经用完）时
+// 不设置，与COMPACT栈一样只依靠栈顶标记检查溢出。COMPACT栈没有保护页，一个slab只占一个VMA
+struct StackSlabs {
+  std::mutex mu;
+  char* next = nullptr;  // 当前slab中下一个未分配的栈
+  char* end = nullptr;
+  std::vector<void*> free;
+
+  void* alloc(StackType type) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (!free.empty()) {
+      void* m = free.back();
+      free.pop_back();
+      return m;
+    }
+    size_t size = stack_guard_size(type) + stack_size(type);
+    if (next == end) {
+      size_t n = std::max<size_t>(STACK_SLAB_SIZE / size, 1);
+      void* slab = mmap(nullptr, size * n, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                        -1, 0);
+      if (slab == MAP_FAILED) {
+        return nullptr;
+      }
+      next = static_cast<char*>(slab);
+      end = next + size * n;
+    }
+    void* m = next;
+    next += size;
+    if (stack_guard_size(type) > 0) {
+      static const size_t limit = guarded_stacks_limit();
+      if (g_guarded_stacks.fetch_add(1, std::memory_order_relaxed) >= limit ||
+          mprotect(m, stack_guard_size(type), PROT_NONE) != 0) {
+        g_guarded_stacks.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+    return m;
+  }
+
+  void put(void* memory, StackType type) {
+    madvise(static_cast<char*>(memory) + stack_guard_size(type),
+            stack_size(type), MADV_DONTNEED);
+    std::lock_guard<std::mutex> lock(mu);
+    free.push_back(memory);
+  }
+};
+
+StackSlabs g_stack_slabs[STACK_TYPE_NUM];
+
+}  // namespace
+
+size_t stack_size(StackType type) {
+  return STACK_SIZES[static_cast<size_t>(type)];
+}
+
+size_t stack_guard_size() {
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page_size;
+}
+
+void* alloc_stack(StackType type) {
+  void* m = g_stack_slabs[static_cast<size_t>(type)].alloc(type);
+  if (m != nullptr) {
+    *stack_canary(m, type) = STACK_CANARY;
+  }
+  return m;
+}
+
+void free_stack(void* memory, StackType type) {
+  if (memory == nullptr) {
+    return;
+  }
+  g_stack_slabs[static_cast<size_t>(type)].put(memory, type);
+}
+
+void report_stack_overwritten(void* memory, StackType type) {
+  fprintf(stderr,
+          "task_coroutine: stack overflow, the canary at the top of stack = "
+          "%p (stack_size = %lu) was overwritten by the adjacent stack\n",
+          memory, stack_size(type));
+  abort();
+}
+
+void* trim_stack(void* memory, StackType type, const void* sp, void* trimmed) {
+  uintptr_t bottom = reinterpret_cast<uintptr_t>(memory) + stack_guard_size(type);
+  uintptr_t p = reinterpret_cast<uintptr_t>(sp);
+  if (p < bottom || p > reinterpret_cast<uintptr_t>(stack_top(memory, type))) {
+    fprintf(stderr,
+            "task_coroutine: stack overflow, stack = %p, stack_size = %lu, "
+            "sp = %p\n",
+            memory, stack_size(type), sp);
+    abort();
+  }
+  // 保留sp以下TRIM_STACK_MARGIN字节所在的页，trim_stack自身和madvise的栈帧在其中
+  size_t page = stack_guard_size();
+  if (p - bottom < TRIM_STACK_MARGIN + page) {
+    return nullptr;
+  }
+  uintptr_t keep = (p - TRIM_STACK_MARGIN) & ~(page - 1);
+  uint64_t* marks = reinterpret_cast<uint64_t*>(keep + 8);
+  sanitizer_unpoison(marks, TRIM_STACK_MARKS * 16);
+  if (trimmed == marks) {
+    size_t i = 0;
+    while (i < TRIM_STACK_MARKS && marks[i * 2] == TRIM_STACK_MARK) {
+      ++i;
+    }
+    if (i == TRIM_STACK_MARKS) {
+      return trimmed;
+    }
+  }
+  if (keep > bottom) {
+    madvise(reinterpret_cast<void*>(bottom), keep - bottom, MADV_DONTNEED);
+  }
+  for (size_t i = 0; i < TRIM_STACK_MARKS; ++i) {
+    marks[i * 2] = TRIM_STACK_MARK;
+  }
+  return marks;
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "task_attr.h"
+
+namespace task_coroutine {
+
+// 协程栈内存布局（地址从低到高）：
+//   memory                   memory + page_size        stack_top
+//   |------ guard page ------|------------ stack_size -----------------|
+//                                                      |-- canary --|
+// 保护页为PROT_NONE，栈溢出时触发SIGSEGV，由stack overflow handler报告
+// 同一类别的栈从一次mmap的16MB slab中切分，释放后放入空闲列表复用，不再munmap；
+// 每个有保护页的栈仍占两个VMA，有保护页的栈超过vm.max_map_count的1/4后，
+// 新切分的栈不再设置保护页，只依靠栈顶标记检查溢出
+// stack_top之上的16字节为栈的标记（canary），紧挨着地址更高的相邻栈的底部，
+// 相邻栈越界时首先覆盖它，每次切换时检查换出和换入的协程，见check_stack_canary
+//
+// COMPACT栈（紧凑栈）用于大量长时间park的协程，例如每个空闲连接一个协程：
+// 1. 没有保护页，一个slab只占一个VMA，协程数不受vm.max_map_count限制
+// 2. 协程换出时调用trim_stack，释放栈指针以下的物理页，
+//    park的协程只占用实际使用的栈，即使之前调用很深
+// 3. 栈的地址不变，协程可以在工作线程间迁移，栈上的TaskWaiter等对象在park期间仍然有效
+// 栈溢出不会触发SIGSEGV：换出时检查栈指针，覆盖到相邻栈时由其标记检查到，
+// 都在溢出发生之后才终止进程，调用深度不可控的协程使用其他栈类别
+
+// stack_size 栈类别对应的可用栈大小
+size_t stack_size(StackType type);
+
+// stack_guard_size 保护页大小
+size_t stack_guard_size();
+
+// stack_guard_size 栈类别type的保护页大小，COMPACT栈没有保护页
+inline size_t stack_guard_size(StackType type) {
+  return type == StackType::COMPACT ? 0 : stack_guard_size();
+}
+
+// STACK_CANARY 栈顶标记的值，STACK_CANARY_SIZE为标记占用的字节数（保持stack_top 16字节对齐）
+constexpr uint64_t STACK_CANARY = 0x636f5f63616e6172ULL;
+constexpr size_t STACK_CANARY_SIZE = 16;
+
+// stack_top 栈底（最高地址），栈从这里向低地址增长
+inline void* stack_top(void* memory, StackType type) {
+  return static_cast<char*>(memory) + stack_guard_size(type) + stack_size(type) -
+         STACK_CANARY_SIZE;
+}
+
+// stack_canary 栈顶标记的位置，由alloc_stack写入
+inline uint64_t* stack_canary(void* memory, StackType type) {
+  return static_cast<uint64_t*>(stack_top(memory, type));
+}
+
+// report_stack_overwritten 栈顶标记被覆盖，报告栈溢出并终止进程
+[[noreturn]] void report_stack_overwritten(void* memory, StackType type);
+
+// alloc_stack 分配栈内存（包括保护页）并写入栈顶标记，失败返回nullptr
+void* alloc_stack(StackType type);
+
+// free_stack 释放alloc_stack分配的栈内存
+void free_stack(void* memory, StackType type);
+
+// trim_stack 释放COMPACT栈中sp以下的物理页，sp为正在运行的协程的栈指针
+// 再次访问释放的页时由内核重新分配清零的页。sp超出栈的范围时报告栈溢出并终止进程
+// trimmed为上一次的返回值（第一次为nullptr）：在保留区域的底部写入标记并返回其位置，
+// 下次在同样的深度换出且标记没有被覆盖（之间没有调用到更深处）时不再调用madvise
+void* trim_stack(void* memory, StackType type, const void* sp, void* trimmed);
+
+// in_stack_guard addr是否位于memory的保护页中
+inline bool in_stack_guard(void* memory, StackType type, const void* addr) {
+  const char* p = static_cast<const char*>(addr);
+  const char* m = static_cast<const char*>(memory);
+  return memory != nullptr && p >= m && p < m + stack_guard_size(type);
+}
+
+}  // namespace task_coroutine
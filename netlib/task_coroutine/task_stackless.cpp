@@ -0,0 +1,62 @@
+#include "task_stackless.h"
+
+namespace task_coroutine {
+
+// 每个线程最多缓存的描述符数量。描述符常在其他线程运行完成后释放，
+// 超过时直接delete，由malloc在线程间平衡
+static constexpr size_t STACKLESS_LOCAL_MAX_SIZE = 1024;
+
+namespace {
+
+// FreeList 线程本地的空闲描述符链表，通过meta.next连接，线程退出时释放
+struct FreeList {
+  TaskMeta* head = nullptr;
+  size_t size = 0;
+
+  ~FreeList() {
+    while (head != nullptr) {
+      TaskMeta* next = head->next;
+      delete reinterpret_cast<StacklessTask*>(head);
+      head = next;
+    }
+  }
+};
+
+thread_local FreeList tls_free_list;
+
+}  // namespace
+
+StacklessTask* StacklessTask::alloc(const TaskAttr& attr) {
+  FreeList& l = tls_free_list;
+  StacklessTask* t;
+  if (l.head != nullptr) {
+    t = reinterpret_cast<StacklessTask*>(l.head);
+    l.head = l.head->next;
+    --l.size;
+  } else {
+    t = new (std::nothrow) StacklessTask();
+    if (t == nullptr) {
+      return nullptr;
+    }
+  }
+  t->meta.next = nullptr;
+  t->meta.group = nullptr;
+  t->meta.set_attr(attr);
+  return t;
+}
+
+void StacklessTask::free(TaskMeta* task) {
+  assert(task->stackless);
+  FreeList& l = tls_free_list;
+  if (l.size >= STACKLESS_LOCAL_MAX_SIZE) {
+    delete reinterpret_cast<StacklessTask*>(task);
+    return;
+  }
+  task->next = l.head;
+  l.head = task;
+  ++l.size;
+}
+
+size_t StacklessTask::cached_size() { return tls_free_list.size; }
+
+}  // namespace task_coroutine
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "task_group.h"
+#include "task_meta.h"
+
+namespace task_coroutine {
+
+// 无栈任务（run-to-completion）
+// post(f)创建的任务与协程使用同一套队列、优先级和窃取，但没有栈和上下文：
+// task_group取到它时直接在主函数的栈上调用f()，运行完成后释放，不需要切换上下文
+// 1. 描述符是固定大小的StacklessTask，可调用对象不超过STACKLESS_STORAGE_SIZE时构造在描述符中，
+//    描述符在线程本地缓存复用，稳态下post不调用malloc/free
+// 2. f不能换出：f中的join、加锁等待、sleep、offload等阻塞所在的工作线程（futex），
+//    并标记为阻塞调用（见BlockingScope），由监控线程把本地队列交给临时线程；
+//    需要频繁等待时用spawn创建协程。f中的Coroutine::yield、maybe_yield什么也不做
+// 3. 适合短小的回调，例如唤醒、关闭连接、投递消息；f运行时间过长同样会被监控线程报告
+
+constexpr size_t STACKLESS_STORAGE_SIZE = 64;
+
+// StacklessTask 无栈任务的描述符，meta为第一个成员，队列中保存&meta
+struct StacklessTask {
+  TaskMeta meta;
+  alignas(16) unsigned char storage[STACKLESS_STORAGE_SIZE];
+
+  StacklessTask() : meta(nullptr, nullptr, nullptr, nullptr) {
+    meta.stackless = true;
+  }
+
+  // alloc 获取一个描述符，优先从线程本地缓存获取，返回的meta需要设置fn/arg
+  static StacklessTask* alloc(const TaskAttr& attr);
+
+  // free 释放run_stackless_task运行完成的描述符，放回线程本地缓存
+  static void free(TaskMeta* task);
+
+  // cached_size 当前线程缓存的描述符数量
+  static size_t cached_size();
+};
+
+// StacklessCallable 在描述符中运行可调用对象F，F不能放入storage时在堆上构造
+template <typename F>
+struct StacklessCallable {
+  static constexpr bool in_place =
+      sizeof(F) <= STACKLESS_STORAGE_SIZE && alignof(F) <= 16;
+
+  // emplace 构造可调用对象，堆上构造时内存不足返回false，g没有被移动
+  template <typename G>
+  static bool emplace(StacklessTask* t, G&& g) {
+    if constexpr (in_place) {
+      t->meta.arg = new (t->storage) F(std::forward<G>(g));
+    } else {
+      t->meta.arg = new (std::nothrow) F(std::forward<G>(g));
+      if (t->meta.arg == nullptr) {
+        return false;
+      }
+    }
+    t->meta.fn = run;
+    return true;
+  }
+
+  static void* run(void* arg) {
+    F* f = static_cast<F*>(arg);
+    (*f)();
+    if constexpr (in_place) {
+      f->~F();
+    } else {
+      delete f;
+    }
+    return nullptr;
+  }
+};
+
+// post 创建运行f()的无栈任务，f的返回值被丢弃，不能等待其完成
+// attr.stack_type被忽略，priority决定放入的队列
+// 返回值：false表示内存不足，没有创建任务，f没有被移动，调用者可以直接调用f()
+// 例：post([conn]() { conn->close(); });
+template <typename F>
+bool post(F&& f, const TaskAttr& attr = TaskAttr()) {
+  StacklessTask* t = StacklessTask::alloc(attr);
+  if (t == nullptr) {
+    return false;
+  }
+  if (!StacklessCallable<typename std::decay<F>::type>::emplace(
+          t, std::forward<F>(f))) {
+    StacklessTask::free(&t->meta);
+    return false;
+  }
+  TaskGroup::start_task(&t->meta);
+  return true;
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace task_coroutine {
+
+// TaskGroupStats task_group的调度统计，从工作线程启动开始累计
+// 通过TaskGroup::stats/TaskControl::stats在任意线程读取，不需要暂停工作线程，
+// 各字段分别读取，不是同一时刻的一致快照
+struct TaskGroupStats {
+  size_t tasks_run;         // 开始运行的协程数
+  size_t context_switches;  // 切换到协程运行的次数，包括park/yield之后重新运行
+  size_t stackless_run;     // 在主函数栈上运行的无栈任务数，见post
+  size_t migrations;        // 协程换到当前task_group继续运行的次数
+  size_t steal_attempts;    // 尝试从其他task_group窃取的次数，每个victim计一次
+  size_t steals;            // 窃取成功的次数
+  size_t parks;             // 找不到任务时park的次数
+  size_t unparks;           // park后被其他线程唤醒的次数，不包括定时任务到期
+  size_t queue_depth_max;   // 本地队列长度的最大值，每SCHED_FAIRNESS_INTERVAL次调度采样一次
+  int64_t idle_ns;          // 找不到本地任务后自旋、窃取和park的时间
+  int64_t running_ns;       // 其余时间，包括运行协程和调度开销
+
+  TaskGroupStats()
+      : tasks_run(0),
+        context_switches(0),
+        stackless_run(0),
+        migrations(0),
+        steal_attempts(0),
+        steals(0),
+        parks(0),
+        unparks(0),
+        queue_depth_max(0),
+        idle_ns(0),
+        running_ns(0) {}
+
+  // operator+= 累加，queue_depth_max取最大值
+  TaskGroupStats& operator+=(const TaskGroupStats& rhs) {
+    tasks_run += rhs.tasks_run;
+    context_switches += rhs.context_switches;
+    stackless_run += rhs.stackless_run;
+    migrations += rhs.migrations;
+    steal_attempts += rhs.steal_attempts;
+    steals += rhs.steals;
+    parks += rhs.parks;
+    unparks += rhs.unparks;
+    queue_depth_max = std::max(queue_depth_max, rhs.queue_depth_max);
+    idle_ns += rhs.idle_ns;
+    running_ns += rhs.running_ns;
+    return *this;
+  }
+};
+
+// StatCounter 只有所属工作线程修改、任意线程读取的计数器
+// 修改使用relaxed的load+store，不需要原子的读改写，开销与普通变量相当
+class StatCounter {
+ public:
+  StatCounter() : value_(0) {}
+
+  StatCounter(const StatCounter&) = delete;
+  StatCounter& operator=(const StatCounter&) = delete;
+
+  void add(size_t n = 1) {
+    value_.store(value_.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+
+  void update_max(size_t v) {
+    if (v > value_.load(std::memory_order_relaxed)) {
+      value_.store(v, std::memory_order_relaxed);
+    }
+  }
+
+  size_t get() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<size_t> value_;
+};
+
+}  // namespace task_coroutine
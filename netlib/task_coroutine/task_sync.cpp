@@ -0,0 +1,205 @@
+#include "task_sync.h"
+
+#include <assert.h>
+
+#include <mutex>
+
+#include "task_group.h"
+
+namespace task_coroutine {
+
+void CoMutex::lock() {
+  mu_.lock();
+  if (!locked_) {
+    locked_ = true;
+    mu_.unlock();
+    return;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  TaskGroup::wait_unlock(&w, &mu_);
+  // 被唤醒时unlock已经把锁交给当前等待者，locked_保持为true
+}
+
+bool CoMutex::try_lock() {
+  std::lock_guard<utils::SpinMutex> lock(mu_);
+  if (locked_) {
+    return false;
+  }
+  locked_ = true;
+  return true;
+}
+
+bool CoMutex::try_lock_until(int64_t deadline_ns) {
+  mu_.lock();
+  if (!locked_) {
+    locked_ = true;
+    mu_.unlock();
+    return true;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  return TaskGroup::wait_unlock_until(&w, &mu_, &waiters_, deadline_ns);
+}
+
+void CoMutex::unlock() {
+  TaskWaiter* w;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    assert(locked_);
+    w = waiters_.pop_front();
+    if (w == nullptr) {
+      locked_ = false;
+    }
+  }
+  if (w != nullptr) {
+    TaskGroup::wake(w);
+  }
+}
+
+void CoCondVar::wait(CoMutex& mutex) {
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  mu_.lock();
+  waiters_.push_back(&w);
+  mutex.unlock();
+  TaskGroup::wait_unlock(&w, &mu_);
+  mutex.lock();
+}
+
+bool CoCondVar::wait_until(CoMutex& mutex, int64_t deadline_ns) {
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  mu_.lock();
+  waiters_.push_back(&w);
+  mutex.unlock();
+  bool ok = TaskGroup::wait_unlock_until(&w, &mu_, &waiters_, deadline_ns);
+  mutex.lock();
+  return ok;
+}
+
+void CoCondVar::notify_one() {
+  TaskWaiter* w;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    w = waiters_.pop_front();
+  }
+  if (w != nullptr) {
+    TaskGroup::wake(w);
+  }
+}
+
+void CoCondVar::notify_all() {
+  WaiterList<TaskWaiter> waiters;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    while (TaskWaiter* w = waiters_.pop_front()) {
+      waiters.push_back(w);
+    }
+  }
+  // 先取出全部等待者再唤醒，唤醒后waiter所在的栈可能被复用，不能再访问w->next
+  while (TaskWaiter* w = waiters.pop_front()) {
+    TaskGroup::wake(w);
+  }
+}
+
+void CoSemaphore::acquire() {
+  mu_.lock();
+  if (count_ > 0) {
+    --count_;
+    mu_.unlock();
+    return;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  TaskGroup::wait_unlock(&w, &mu_);
+  // 被唤醒时release已经把计数交给当前等待者
+}
+
+bool CoSemaphore::try_acquire() {
+  std::lock_guard<utils::SpinMutex> lock(mu_);
+  if (count_ == 0) {
+    return false;
+  }
+  --count_;
+  return true;
+}
+
+bool CoSemaphore::try_acquire_until(int64_t deadline_ns) {
+  mu_.lock();
+  if (count_ > 0) {
+    --count_;
+    mu_.unlock();
+    return true;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  // 超时撤销登记时release不会再把计数交给当前等待者
+  return TaskGroup::wait_unlock_until(&w, &mu_, &waiters_, deadline_ns);
+}
+
+void CoSemaphore::release(size_t n) {
+  WaiterList<TaskWaiter> waiters;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    for (; n > 0 && !waiters_.empty(); --n) {
+      waiters.push_back(waiters_.pop_front());
+    }
+    count_ += n;
+  }
+  while (TaskWaiter* w = waiters.pop_front()) {
+    TaskGroup::wake(w);
+  }
+}
+
+void WaitGroup::add(size_t n) {
+  std::lock_guard<utils::SpinMutex> lock(mu_);
+  count_ += n;
+}
+
+void WaitGroup::done() {
+  WaiterList<TaskWaiter> waiters;
+  {
+    std::lock_guard<utils::SpinMutex> lock(mu_);
+    assert(count_ > 0);
+    if (--count_ > 0) {
+      return;
+    }
+    while (TaskWaiter* w = waiters_.pop_front()) {
+      waiters.push_back(w);
+    }
+  }
+  while (TaskWaiter* w = waiters.pop_front()) {
+    TaskGroup::wake(w);
+  }
+}
+
+void WaitGroup::wait() {
+  mu_.lock();
+  if (count_ == 0) {
+    mu_.unlock();
+    return;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  TaskGroup::wait_unlock(&w, &mu_);
+}
+
+bool WaitGroup::wait_until(int64_t deadline_ns) {
+  mu_.lock();
+  if (count_ == 0) {
+    mu_.unlock();
+    return true;
+  }
+  TaskWaiter w;
+  w.task = TaskGroup::current_task();
+  waiters_.push_back(&w);
+  return TaskGroup::wait_unlock_until(&w, &mu_, &waiters_, deadline_ns);
+}
+
+}  // namespace task_coroutine
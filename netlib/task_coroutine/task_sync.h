@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+
+#include "task_timer.h"
+#include "task_waiter.h"
+#include "utils/spin_mutex.h"
+
+namespace task_coroutine {
+
+// 协程同步原语
+// 在协程中等待时park当前协程，唤醒时重新入队，不会阻塞工作线程；
+// 在非工作线程中等待时阻塞在futex上。内部状态由SpinMutex保护，临界区很短
+// 带超时的等待由所在工作线程的时间轮唤醒，超时返回false
+
+// CoMutex 互斥锁，unlock时直接把锁交给最早等待的一方
+class CoMutex {
+ public:
+  CoMutex() : locked_(false) {}
+
+  CoMutex(const CoMutex&) = delete;
+  CoMutex& operator=(const CoMutex&) = delete;
+
+  void lock();
+
+  bool try_lock();
+
+  template <typename Rep, typename Period>
+  bool try_lock_for(const std::chrono::duration<Rep, Period>& d) {
+    return try_lock_until(deadline_ns(d));
+  }
+
+  // try_lock_until deadline_ns为monotonic_ns
+  bool try_lock_until(int64_t deadline_ns);
+
+  void unlock();
+
+ private:
+  utils::SpinMutex mu_;
+  bool locked_;
+  WaiterList<TaskWaiter> waiters_;
+};
+
+// CoCondVar 条件变量，配合CoMutex使用
+class CoCondVar {
+ public:
+  CoCondVar() {}
+
+  CoCondVar(const CoCondVar&) = delete;
+  CoCondVar& operator=(const CoCondVar&) = delete;
+
+  // wait 释放mutex并等待notify，返回前重新获取mutex
+  void wait(CoMutex& mutex);
+
+  template <typename Predicate>
+  void wait(CoMutex& mutex, Predicate pred) {
+    while (!pred()) {
+      wait(mutex);
+    }
+  }
+
+  // wait_for 释放mutex并最多等待d，返回前重新获取mutex，返回值：false表示超时
+  template <typename Rep, typename Period>
+  bool wait_for(CoMutex& mutex, const std::chrono::duration<Rep, Period>& d) {
+    return wait_until(mutex, deadline_ns(d));
+  }
+
+  // wait_until deadline_ns为monotonic_ns
+  bool wait_until(CoMutex& mutex, int64_t deadline_ns);
+
+  void notify_one();
+
+  void notify_all();
+
+ private:
+  utils::SpinMutex mu_;
+  WaiterList<TaskWaiter> waiters_;
+};
+
+// CoSemaphore 计数信号量
+class CoSemaphore {
+ public:
+  explicit CoSemaphore(size_t count = 0) : count_(count) {}
+
+  CoSemaphore(const CoSemaphore&) = delete;
+  CoSemaphore& operator=(const CoSemaphore&) = delete;
+
+  void acquire();
+
+  bool try_acquire();
+
+  template <typename Rep, typename Period>
+  bool try_acquire_for(const std::chrono::duration<Rep, Period>& d) {
+    return try_acquire_until(deadline_ns(d));
+  }
+
+  // try_acquire_until deadline_ns为monotonic_ns
+  bool try_acquire_until(int64_t deadline_ns);
+
+  void release(size_t n = 1);
+
+ private:
+  utils::SpinMutex mu_;
+  size_t count_;
+  WaiterList<TaskWaiter> waiters_;
+};
+
+// WaitGroup 等待一组任务完成
+class WaitGroup {
+ public:
+  explicit WaitGroup(size_t count = 0) : count_(count) {}
+
+  WaitGroup(const WaitGroup&) = delete;
+  WaitGroup& operator=(const WaitGroup&) = delete;
+
+  void add(size_t n = 1);
+
+  // done 计数减1，减到0时唤醒所有等待者
+  void done();
+
+  // wait 等待计数减到0
+  void wait();
+
+  // wait_for 最多等待d，返回值：false表示超时
+  template <typename Rep, typename Period>
+  bool wait_for(const std::chrono::duration<Rep, Period>& d) {
+    return wait_until(deadline_ns(d));
+  }
+
+  // wait_until deadline_ns为monotonic_ns
+  bool wait_until(int64_t deadline_ns);
+
+ private:
+  utils::SpinMutex mu_;
+  size_t count_;
+  WaiterList<TaskWaiter> waiters_;
+};
+
+}  // namespace task_coroutine
@@ -0,0 +1,179 @@
+#include "task_timer.h"
+
+#include <assert.h>
+
+#include <new>
+
+#include "task_futex.h"
+
+namespace task_coroutine {
+
+TimerWheel::TimerWheel()
+    : base_ns_(monotonic_ns()), cur_tick_(0), count_(0), pending_(0) {}
+
+TimerWheel::~TimerWheel() {
+  auto clear = [](Slot* slot) {
+    while (slot->head != nullptr) {
+      TimerNode* node = slot->head;
+      slot->head = node->next;
+      release(node);
+    }
+  };
+  for (int64_t i = 0; i < L0_SIZE; ++i) {
+    clear(&l0_[i]);
+  }
+  for (int level = 0; level < LEVELS - 1; ++level) {
+    for (int64_t i = 0; i < LN_SIZE; ++i) {
+      clear(&ln_[level][i]);
+    }
+  }
+}
+
+TimerNode* TimerWheel::add(int64_t deadline_ns, void (*fn)(void*), void* arg) {
+  TimerNode* node = new (std::nothrow) TimerNode;
+  assert(node != nullptr);
+  // 向上取整，定时任务不会提前运行
+  int64_t tick = deadline_ns > base_ns_
+                     ? (deadline_ns - base_ns_ + TICK_NS - 1) / TICK_NS
+                     : 0;
+  node->expire_tick = tick < cur_tick_ ? cur_tick_ : tick;
+  node->fn = fn;
+  node->arg = arg;
+  node->state.store(TimerNode::PENDING, std::memory_order_relaxed);
+  node->ref.store(2, std::memory_order_relaxed);
+  node->wheel = this;
+  node->next = nullptr;
+  insert(node);
+  ++count_;
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  return node;
+}
+
+bool TimerWheel::cancel(TimerNode* node) {
+  int state = TimerNode::PENDING;
+  bool ok = node->state.compare_exchange_strong(
+      state, TimerNode::CANCELLED, std::memory_order_acq_rel);
+  if (ok) {
+    node->wheel->pending_.fetch_sub(1, std::memory_order_relaxed);
+  } else {
+    // fn运行在其他工作线程上，等待其完成后才能释放fn访问的资源
+    while (node->state.load(std::memory_order_acquire) == TimerNode::RUNNING) {
+      cpu_relax();
+    }
+  }
+  release(node);
+  return ok;
+}
+
+size_t TimerWheel::advance(int64_t now_ns) {
+  int64_t now_tick = (now_ns - base_ns_) / TICK_NS;
+  if (count_ == 0) {
+    if (now_tick >= cur_tick_) {
+      cur_tick_ = now_tick + 1;
+    }
+    return 0;
+  }
+  size_t n = 0;
+  while (cur_tick_ <= now_tick && count_ > 0) {
+    int64_t idx = cur_tick_ & (L0_SIZE - 1);
+    // 进入低层新的一轮时，把高层对应slot中的定时任务降级
+    for (int level = 1; idx == 0 && level < LEVELS; ++level) {
+      cascade(level);
+      int shift = L0_BITS + (level - 1) * LN_BITS;
+      idx = (cur_tick_ >> shift) & (LN_SIZE - 1);
+    }
+    Slot* slot = &l0_[cur_tick_ & (L0_SIZE - 1)];
+    TimerNode* node = slot->head;
+    slot->head = nullptr;
+    while (node != nullptr) {
+      TimerNode* next = node->next;
+      --count_;
+      if (node->state.load(std::memory_order_relaxed) == TimerNode::PENDING) {
+        ++n;
+      }
+      expire(node);
+      node = next;
+    }
+    ++cur_tick_;
+  }
+  if (count_ == 0 && now_tick >= cur_tick_) {
+    cur_tick_ = now_tick + 1;
+  }
+  return n;
+}
+
+int64_t TimerWheel::next_timeout_ns() const {
+  if (count_ == 0) {
+    return -1;
+  }
+  // 只查看第0层到本轮结束，高层的定时任务在下一轮开始时降级，不晚于其到期时间
+  int64_t end = (cur_tick_ | (L0_SIZE - 1)) + 1;
+  int64_t tick = cur_tick_;
+  for (; tick < end; ++tick) {
+    if ((tick & (L0_SIZE - 1)) == 0 || l0_[tick & (L0_SIZE - 1)].head != nullptr) {
+      break;
+    }
+  }
+  return base_ns_ + tick * TICK_NS;
+}
+
+void TimerWheel::insert(TimerNode* node) {
+  int64_t expire = node->expire_tick;
+  int64_t delta = expire - cur_tick_;
+  if (delta < L0_SIZE) {
+    link(&l0_[expire & (L0_SIZE - 1)], node);
+    return;
+  }
+  for (int level = 1; level < LEVELS; ++level) {
+    int shift = L0_BITS + (level - 1) * LN_BITS;
+    int64_t limit = static_cast<int64_t>(1) << (shift + LN_BITS);
+    if (delta < limit || level == LEVELS - 1) {
+      if (delta >= limit) {  // 超出范围，放在最高层最远的slot，到达时重新计算
+        expire = cur_tick_ + limit - 1;
+      }
+      link(&ln_[level - 1][(expire >> shift) & (LN_SIZE - 1)], node);
+      return;
+    }
+  }
+}
+
+void TimerWheel::cascade(int level) {
+  int shift = L0_BITS + (level - 1) * LN_BITS;
+  Slot* slot = &ln_[level - 1][(cur_tick_ >> shift) & (LN_SIZE - 1)];
+  TimerNode* node = slot->head;
+  slot->head = nullptr;
+  while (node != nullptr) {
+    TimerNode* next = node->next;
+    if (node->state.load(std::memory_order_acquire) == TimerNode::CANCELLED) {
+      --count_;
+      release(node);
+    } else {
+      insert(node);
+    }
+    node = next;
+  }
+}
+
+void TimerWheel::expire(TimerNode* node) {
+  int state = TimerNode::PENDING;
+  if (node->state.compare_exchange_strong(state, TimerNode::RUNNING,
+                                          std::memory_order_acq_rel)) {
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    node->fn(node->arg);
+    node->state.store(TimerNode::DONE, std::memory_order_release);
+  }
+  release(node);
+}
+
+void TimerWheel::release(TimerNode* node) {
+  if (node->ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete node;
+  }
+}
+
+void TimerWheel::link(Slot* slot, TimerNode* node) {
+  node->next = slot->head;
+  slot->head = node;
+}
+
+}  // namespace task_coroutine
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace task_coroutine {
+
+// monotonic_ns 单调时钟，纳秒
+inline int64_t monotonic_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// to_timespec 纳秒转换为timespec，用于futex_wait的相对超时
+inline struct timespec to_timespec(int64_t ns) {
+  struct timespec ts;
+  ts.tv_sec = ns / 1000000000;
+  ts.tv_nsec = ns % 1000000000;
+  return ts;
+}
+
+// deadline_ns 把当前时间之后的d转换为monotonic_ns表示的截止时间
+template <typename Rep, typename Period>
+inline int64_t deadline_ns(const std::chrono::duration<Rep, Period>& d) {
+  return monotonic_ns() +
+         std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+// deadline_ns 把任意时钟的时间点转换为monotonic_ns表示的截止时间
+template <typename Clock, typename Duration>
+inline int64_t deadline_ns(const std::chrono::time_point<Clock, Duration>& tp) {
+  return deadline_ns(tp - Clock::now());
+}
+
+class TimerWheel;
+
+// TimerNode 定时任务
+// 引用计数为2：TimerWheel一个，调用add的一方一个（通过TimerWheel::cancel释放），
+// 因此取消方可以在其他线程安全地访问节点
+struct TimerNode {
+  static constexpr int PENDING = 0;
+  static constexpr int RUNNING = 1;
+  static constexpr int DONE = 2;
+  static constexpr int CANCELLED = 3;
+
+  int64_t expire_tick;
+  void (*fn)(void*);
+  void* arg;
+  std::atomic<int> state;
+  std::atomic<int> ref;
+  TimerWheel* wheel;  // 所在的时间轮，取消时更新其pending_
+  TimerNode* next;
+};
+
+// TimerWheel 分层时间轮，每个TaskGroup一个，只能由所属工作线程add和advance
+// 精度为1ms，4层：256 * 64 * 64 * 64个tick，超出范围的定时任务放在最高层，
+// 到达时重新计算位置。插入、到期都是O(1)，取消只修改状态，节点在到达所在slot时移除
+class TimerWheel {
+ public:
+  static constexpr int64_t TICK_NS = 1000000;  // 1ms
+
+  TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  ~TimerWheel();
+
+  // add 添加在deadline_ns（monotonic_ns）到期的定时任务，到期时在所属工作线程调用fn(arg)
+  // fn中不能切换协程。返回值需要调用cancel释放
+  TimerNode* add(int64_t deadline_ns, void (*fn)(void*), void* arg);
+
+  // cancel 取消定时任务并释放add返回的引用，可以在任意线程调用
+  // fn正在运行时等待其完成。返回值：true表示取消成功，fn不会被调用
+  static bool cancel(TimerNode* node);
+
+  // advance 运行到期的定时任务，返回运行的个数
+  size_t advance(int64_t now_ns);
+
+  bool empty() const { return count_ == 0; }
+
+  // has_pending 是否有没有到期也没有取消的定时任务；empty包括已取消但未移除的节点，
+  // 它们要到原来的到期时间才移除。可以在任意线程取消，只能由所属工作线程调用
+  bool has_pending() const {
+    return pending_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // next_timeout_ns 下一次需要advance的时间（monotonic_ns），不晚于最早的到期时间
+  // 没有定时任务时返回-1
+  int64_t next_timeout_ns() const;
+
+ private:
+  static constexpr int LEVELS = 4;
+  static constexpr int L0_BITS = 8;
+  static constexpr int LN_BITS = 6;
+  static constexpr int64_t L0_SIZE = 1 << L0_BITS;
+  static constexpr int64_t LN_SIZE = 1 << LN_BITS;
+
+  struct Slot {
+    TimerNode* head = nullptr;
+  };
+
+  void insert(TimerNode* node);
+
+  // cascade 把第level层当前slot的定时任务重新放入更低的层
+  void cascade(int level);
+
+  void expire(TimerNode* node);
+
+  static void release(TimerNode* node);
+
+  static void link(Slot* slot, TimerNode* node);
+
+  Slot l0_[L0_SIZE];
+  Slot ln_[LEVELS - 1][LN_SIZE];
+  int64_t base_ns_;   // tick 0对应的时间
+  int64_t cur_tick_;  // 下一个需要处理的tick
+  size_t count_;      // 时间轮中的节点数，包括已取消但未移除的
+  std::atomic<size_t> pending_;  // 没有到期也没有取消的节点数
+};
+
+}  // namespace task_coroutine
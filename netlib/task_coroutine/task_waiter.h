@@ -0,0 +1,80 @@
+#pragma once
+
+#include "task_futex.h"
+
+namespace task_coroutine {
+
+struct TaskMeta;
+
+// TaskWaiter 等待某个事件的协程或线程，通常分配在等待者的栈上
+// 1. 工作线程上的协程：task为当前协程，等待时park，唤醒时重新入队
+// 2. 非工作线程：task为nullptr，等待时阻塞在futex上，唤醒时futex置1
+struct TaskWaiter {
+  TaskMeta* task;
+  std::atomic<uint32_t> futex;
+  TaskWaiter* prev;  // WaiterList中的前一个
+  TaskWaiter* next;  // WaiterList中的后一个
+
+  TaskWaiter() : task(nullptr), futex(0), prev(nullptr), next(nullptr) {}
+
+  TaskWaiter(const TaskWaiter&) = delete;
+  TaskWaiter& operator=(const TaskWaiter&) = delete;
+};
+
+// WaiterList 侵入式双向链表，T需要有prev和next成员，由使用者加锁保护
+template <typename T>
+class WaiterList {
+ public:
+  WaiterList() : head_(nullptr), tail_(nullptr) {}
+
+  WaiterList(const WaiterList&) = delete;
+  WaiterList& operator=(const WaiterList&) = delete;
+
+  bool empty() const { return head_ == nullptr; }
+
+  T* front() const { return head_; }
+
+  // linked w是否在链表中
+  bool linked(const T* w) const { return w->prev != nullptr || head_ == w; }
+
+  void push_back(T* w) {
+    w->prev = tail_;
+    w->next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = w;
+    } else {
+      head_ = w;
+    }
+    tail_ = w;
+  }
+
+  T* pop_front() {
+    T* w = head_;
+    if (w != nullptr) {
+      erase(w);
+    }
+    return w;
+  }
+
+  // erase w必须在链表中
+  void erase(T* w) {
+    if (w->prev != nullptr) {
+      w->prev->next = w->next;
+    } else {
+      head_ = w->next;
+    }
+    if (w->next != nullptr) {
+      w->next->prev = w->prev;
+    } else {
+      tail_ = w->prev;
+    }
+    w->prev = nullptr;
+    w->next = nullptr;
+  }
+
+ private:
+  T* head_;
+  T* tail_;
+};
+
+}  // namespace task_coroutine
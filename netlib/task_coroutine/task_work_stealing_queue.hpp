@@ -0,0 +1,107 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <new>
+
+namespace task_coroutine {
+
+// WorkStealingQueue Chase-Lev无锁双端队列
+// 1. 所属线程（owner）在bottom端push/pop，后进先出，无锁且不与其他线程竞争
+// 2. 其他线程（thief）在top端steal，先进先出，多个thief之间通过CAS竞争
+// 3. 容量固定（2的幂），push失败时由调用方处理溢出
+// 参考：Lê et al. "Correct and Efficient Work-Stealing for Weak Memory Models"
+template <typename T>
+class WorkStealingQueue {
+ public:
+  explicit WorkStealingQueue(size_t capacity = 4096)
+      : top_(0), bottom_(0), capacity_(round_up_power_of_2(capacity)) {
+    buffer_ = new (std::nothrow) std::atomic<T>[capacity_];
+    assert(buffer_ != nullptr);
+  }
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+  WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+  ~WorkStealingQueue() { delete[] buffer_; }
+
+  // push 只能由owner调用，队列满时返回false
+  bool push(const T& value) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t >= static_cast<int64_t>(capacity_)) {
+      return false;
+    }
+    buffer_[b & (capacity_ - 1)].store(value, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // pop 只能由owner调用，从bottom端取出最后push的元素
+  bool pop(T& ret) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    // top_只增不减，此时已经为空就不需要修改bottom_和内存屏障，轮询多个空队列时开销小
+    if (b <= top_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    --b;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {  // 队列为空
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    ret = buffer_[b & (capacity_ - 1)].load(std::memory_order_relaxed);
+    if (t == b) {  // 最后一个元素，与thief竞争
+      bool ok = top_.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return ok;
+    }
+    return true;
+  }
+
+  // steal 任意线程调用，从top端取出最早push的元素
+  bool steal(T& ret) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    ret = buffer_[t & (capacity_ - 1)].load(std::memory_order_relaxed);
+    return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+  }
+
+  // volatile_size 近似的元素个数，仅用于启发式判断
+  size_t volatile_size() const {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    return b <= t ? 0 : static_cast<size_t>(b - t);
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static size_t round_up_power_of_2(size_t n) {
+    size_t c = 2;
+    while (c < n) {
+      c <<= 1;
+    }
+    return c;
+  }
+
+  alignas(64) std::atomic<int64_t> top_;     // thief端
+  alignas(64) std::atomic<int64_t> bottom_;  // owner端
+  alignas(64) size_t capacity_;
+  std::atomic<T>* buffer_;
+};
+
+}  // namespace task_coroutine
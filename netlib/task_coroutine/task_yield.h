@@ -0,0 +1,16 @@
+#pragma once
+
+#include "utils/task_hooks.h"
+
+namespace task_coroutine {
+
+// 协作式抢占
+// 监控线程发现协程运行超过时间片（TaskControlOptions::time_slice_ms）时，
+// 设置所在工作线程的should_yield标记。长时间运行的循环定期调用maybe_yield，
+// 标记被设置时让出当前协程，被设置之前只有一次原子读和间接调用的开销
+// maybe_yield通过utils/task_hooks.h中的g_maybe_yield_fn调用，基础模块直接使用utils中的版本
+
+using utils::maybe_yield;
+using utils::YieldCounter;
+
+}  // namespace task_coroutine
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "task_coroutine/task_coroutine.h"
+
+// 协程库性能测试
+// make bench_task_coroutine && ./main [工作线程数]
+
+static int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void* empty_fn(void* arg) { return nullptr; }
+
+struct SpawnArg {
+  size_t total;
+  size_t batch;
+  int64_t cost_ns;
+};
+
+// bench_spawn 在工作线程中批量创建并join协程，统计每个协程的创建+销毁耗时
+static void* bench_spawn(void* arg) {
+  SpawnArg* sa = static_cast<SpawnArg*>(arg);
+  std::vector<task_coroutine::Coroutine> cs;
+  cs.reserve(sa->batch);
+  int64_t begin = now_ns();
+  for (size_t done = 0; done < sa->total; done += sa->batch) {
+    for (size_t i = 0; i < sa->batch; ++i) {
+      cs.emplace_back(empty_fn, nullptr);
+    }
+    for (auto& c : cs) {
+      c.join();
+    }
+    cs.clear();
+  }
+  sa->cost_ns = now_ns() - begin;
+  return nullptr;
+}
+
+// bench_spawn_n 在工作线程中使用spawn_n批量创建并join协程
+static void* bench_spawn_n(void* arg) {
+  SpawnArg* sa = static_cast<SpawnArg*>(arg);
+  int64_t begin = now_ns();
+  for (size_t done = 0; done < sa->total; done += sa->batch) {
+    auto cs = task_coroutine::Coroutine::spawn_n(sa->batch, empty_fn);
+    for (auto& c : cs) {
+      c.join();
+    }
+  }
+  sa->cost_ns = now_ns() - begin;
+  return nullptr;
+}
+
+struct PingPongArg {
+  size_t rounds;
+  task_coroutine::CoSemaphore ping;
+  task_coroutine::CoSemaphore pong;
+};
+
+static void* ping_fn(void* arg) {
+  PingPongArg* pa = static_cast<PingPongArg*>(arg);
+  for (size_t i = 0; i < pa->rounds; ++i) {
+    pa->ping.release();
+    pa->pong.acquire();
+  }
+  return nullptr;
+}
+
+static void* pong_fn(void* arg) {
+  PingPongArg* pa = static_cast<PingPongArg*>(arg);
+  for (size_t i = 0; i < pa->rounds; ++i) {
+    pa->ping.acquire();
+    pa->pong.release();
+  }
+  return nullptr;
+}
+
+// bench_ping_pong pairs对协程通过信号量交替唤醒，模拟生产者/消费者
+static void bench_ping_pong(size_t pairs, size_t rounds) {
+  std::vector<PingPongArg> args(pairs);
+  std::vector<task_coroutine::Coroutine> cs;
+  size_t migrations = task_coroutine::TaskControl::get()->migration_count();
+  int64_t begin = now_ns();
+  for (auto& pa : args) {
+    pa.rounds = rounds;
+    cs.emplace_back(ping_fn, &pa);
+    cs.emplace_back(pong_fn, &pa);
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  int64_t cost = now_ns() - begin;
+  size_t ops = pairs * rounds;
+  printf("ping_pong: pairs = %lu, rounds = %lu, %.1f ns/op, migrations = %lu\n",
+         pairs, rounds, static_cast<double>(cost) / ops,
+         task_coroutine::TaskControl::get()->migration_count() - migrations);
+}
+
+// deep 递归消耗约depth KB栈
+static size_t deep(size_t depth) {
+  volatile char buf[1024];
+  buf[0] = static_cast<char>(depth);
+  return depth == 0 ? buf[0] : deep(depth - 1) + buf[0];
+}
+
+static void* yield_fn(void* arg) {
+  size_t n = reinterpret_cast<size_t>(arg);
+  for (size_t i = 0; i < n; ++i) {
+    task_coroutine::Coroutine::yield();
+  }
+  return nullptr;
+}
+
+// yield_deep_fn 每次yield之前调用16KB深，COMPACT栈每次换出都要释放物理页
+static void* yield_deep_fn(void* arg) {
+  size_t n = reinterpret_cast<size_t>(arg);
+  for (size_t i = 0; i < n; ++i) {
+    deep(16);
+    task_coroutine::Coroutine::yield();
+  }
+  return nullptr;
+}
+
+static const char* stack_type_name(task_coroutine::StackType type) {
+  switch (type) {
+    case task_coroutine::StackType::SMALL:
+      return "SMALL";
+    case task_coroutine::StackType::NORMAL:
+      return "NORMAL";
+    case task_coroutine::StackType::LARGE:
+      return "LARGE";
+    case task_coroutine::StackType::COMPACT:
+      return "COMPACT";
+  }
+  return "?";
+}
+
+// bench_yield num个协程各yield rounds次，deep为true时每次yield之前调用16KB深
+static void bench_yield(size_t num, size_t rounds,
+                        task_coroutine::StackType type =
+                            task_coroutine::StackType::NORMAL,
+                        bool deep = false) {
+  std::vector<task_coroutine::Coroutine> cs;
+  size_t migrations = task_coroutine::TaskControl::get()->migration_count();
+  int64_t begin = now_ns();
+  for (size_t i = 0; i < num; ++i) {
+    cs.emplace_back(deep ? yield_deep_fn : yield_fn,
+                    reinterpret_cast<void*>(rounds), type);
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  int64_t cost = now_ns() - begin;
+  printf(
+      "%s: stack = %s, num = %lu, rounds = %lu, %.1f ns/op, migrations = "
+      "%lu\n",
+      deep ? "yield_deep" : "yield", stack_type_name(type), num, rounds,
+      static_cast<double>(cost) / (num * rounds),
+      task_coroutine::TaskControl::get()->migration_count() - migrations);
+}
+
+static size_t rss_bytes() {
+  FILE* f = fopen("/proc/self/statm", "r");
+  size_t pages = 0, rss = 0;
+  if (f != nullptr) {
+    if (fscanf(f, "%lu %lu", &pages, &rss) != 2) {
+      rss = 0;
+    }
+    fclose(f);
+  }
+  return rss * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// bench_parked_memory num个协程调用depth KB深之后park，统计每个park的协程占用的物理内存
+static void bench_parked_memory(task_coroutine::StackType type, size_t num,
+                                size_t depth) {
+  task_coroutine::CoSemaphore sem;
+  std::atomic<size_t> parked(0);
+  size_t before = rss_bytes();
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  hs.reserve(num);
+  for (size_t i = 0; i < num; ++i) {
+    hs.push_back(task_coroutine::spawn(
+        [&sem, &parked, depth]() {
+          deep(depth);
+          parked.fetch_add(1);
+          sem.acquire();
+        },
+        type));
+  }
+  while (parked.load() < num) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  size_t after = rss_bytes();
+  sem.release(num);
+  for (auto& h : hs) {
+    h.join();
+  }
+  printf("parked_memory: stack = %s, num = %lu, depth = %lu KB, %.0f bytes/task\n",
+         stack_type_name(type), num, depth,
+         static_cast<double>(after > before ? after - before : 0) / num);
+}
+
+// bench_inject threads个非工作线程各创建并join total个协程，经过全局注入队列
+static void bench_inject(size_t threads, size_t total, size_t batch) {
+  int64_t begin = now_ns();
+  std::vector<std::thread> ts;
+  for (size_t t = 0; t < threads; ++t) {
+    ts.emplace_back([total, batch]() {
+      std::vector<task_coroutine::Coroutine> cs;
+      cs.reserve(batch);
+      for (size_t done = 0; done < total; done += batch) {
+        for (size_t i = 0; i < batch; ++i) {
+          cs.emplace_back(empty_fn, nullptr);
+        }
+        for (auto& c : cs) {
+          c.join();
+        }
+        cs.clear();
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+  int64_t cost = now_ns() - begin;
+  printf("inject: threads = %lu, total = %lu, %.1f ns/op\n", threads, total,
+         static_cast<double>(cost) / (threads * total));
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    task_coroutine::TaskControlOptions options;
+    options.task_groups_num = static_cast<size_t>(atoi(argv[1]));
+    task_coroutine::TaskControl::init(options);
+  }
+  SpawnArg sa{1000000, 100, 0};
+  task_coroutine::Coroutine c(bench_spawn, &sa);
+  c.join();
+  printf("spawn_join: total = %lu, batch = %lu, %.1f ns/op\n", sa.total,
+         sa.batch, static_cast<double>(sa.cost_ns) / sa.total);
+  SpawnArg sna{1000000, 100, 0};
+  task_coroutine::Coroutine cn(bench_spawn_n, &sna);
+  cn.join();
+  printf("spawn_n_join: total = %lu, batch = %lu, %.1f ns/op\n", sna.total,
+         sna.batch, static_cast<double>(sna.cost_ns) / sna.total);
+  bench_ping_pong(4, 100000);
+  bench_yield(64, 10000);
+  bench_yield(64, 10000, task_coroutine::StackType::COMPACT);
+  bench_yield(64, 10000, task_coroutine::StackType::NORMAL, true);
+  bench_yield(64, 10000, task_coroutine::StackType::COMPACT, true);
+  bench_inject(4, 100000, 100);
+  // 每种栈类别使用新分配的栈，先测COMPACT，TaskMetaPool中没有调用过deep的栈
+  bench_parked_memory(task_coroutine::StackType::COMPACT, 10000, 32);
+  bench_parked_memory(task_coroutine::StackType::SMALL, 10000, 4);
+  bench_parked_memory(task_coroutine::StackType::NORMAL, 10000, 32);
+  task_coroutine::TaskGroupStats st =
+      task_coroutine::TaskControl::get()->total_stats();
+  printf(
+      "stats: tasks_run = %lu, context_switches = %lu, steals = %lu/%lu, "
+      "parks = %lu, unparks = %lu, queue_depth_max = %lu, idle = %.1f ms, "
+      "running = %.1f ms\n",
+      st.tasks_run, st.context_switches, st.steals, st.steal_attempts,
+      st.parks, st.unparks, st.queue_depth_max, st.idle_ns / 1e6,
+      st.running_ns / 1e6);
+  return 0;
+}
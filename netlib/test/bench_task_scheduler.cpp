@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "task_coroutine/task_coroutine.h"
+
+// 调度器微基准测试：上下文切换、spawn/join、yield、ping-pong、跨task_group唤醒延迟、窃取
+// make bench_task_scheduler && ./main [-b] [-t time_slice_ms] [工作线程数...]
+//   -b 工作线程绑定CPU，-t 时间片（0表示不启动监控线程），工作线程数默认为1 2 4
+// TaskControl每个进程只能初始化一次，每个工作线程数在fork出的子进程中运行
+//
+// 每个结果输出一行JSON，便于脚本比较不同版本、不同调度参数：
+//   {"bench":"yield","workers":4,"tasks":64,"ops":...,"ns_per_op":...,"ops_per_sec":...,
+//    "p50_ns":...,"p90_ns":...,"p99_ns":...,"max_ns":...,"samples":...}
+// ns_per_op/ops_per_sec为全部操作的平均值；百分位为样本的分布，wake_latency的样本为单次唤醒延迟，
+// 其余为每次试验（一批操作）的平均耗时
+
+using task_coroutine::monotonic_ns;
+
+struct Mode {
+  bool bind_cpu = false;
+  int64_t time_slice_ms = 100;
+};
+
+static Mode g_mode;
+
+// Result 一项测试的结果
+struct Result {
+  const char* bench;
+  size_t tasks;
+  size_t ops;
+  int64_t total_ns;
+  std::vector<double> samples;  // 纳秒
+  std::string extra;  // 附加的JSON字段，以逗号开头
+};
+
+static double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+static void report(Result& r) {
+  std::sort(r.samples.begin(), r.samples.end());
+  double ns_per_op = r.ops > 0 ? static_cast<double>(r.total_ns) / r.ops : 0;
+  printf(
+      "{\"bench\":\"%s\",\"workers\":%lu,\"bind_cpu\":%s,\"time_slice_ms\":%ld,"
+      "\"tasks\":%lu,\"ops\":%lu,\"ns_per_op\":%.1f,\"ops_per_sec\":%.0f,"
+      "\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,"
+      "\"samples\":%lu%s}\n",
+      r.bench, task_coroutine::TaskControl::get()->task_groups_num(),
+      g_mode.bind_cpu ? "true" : "false",
+      static_cast<long>(g_mode.time_slice_ms), r.tasks, r.ops, ns_per_op,
+      ns_per_op > 0 ? 1e9 / ns_per_op : 0, percentile(r.samples, 0.5),
+      percentile(r.samples, 0.9), percentile(r.samples, 0.99),
+      r.samples.empty() ? 0 : r.samples.back(), r.samples.size(),
+      r.extra.c_str());
+  fflush(stdout);
+}
+
+// run_in_task 在协程中运行f，等待完成
+template <typename F>
+static void run_in_task(F&& f) {
+  task_coroutine::spawn(std::forward<F>(f)).join();
+}
+
+// current_group 当前工作线程的task_group，不内联，协程换出后重新读取线程局部变量
+__attribute__((noinline)) static void* current_group() {
+  return task_coroutine::tls_task_group;
+}
+
+// 1. switch 两个上下文之间直接调用task_coroutine_jump_fcontext，不经过调度器
+static void* g_main_ctx;
+static void* g_switch_ctx;
+
+static void switch_fn() {
+  for (;;) {
+    task_coroutine_jump_fcontext(&g_switch_ctx, g_main_ctx);
+  }
+}
+
+static void bench_switch() {
+  constexpr size_t trials = 100, rounds = 10000;
+  void* memory = task_coroutine::alloc_stack(task_coroutine::StackType::NORMAL);
+  g_switch_ctx = task_coroutine_make_fcontext(
+      task_coroutine::stack_top(memory, task_coroutine::StackType::NORMAL),
+      switch_fn);
+  Result r{"switch", 1, trials * rounds * 2, 0, {}, ""};
+  for (size_t t = 0; t < trials; ++t) {
+    int64_t begin = monotonic_ns();
+    for (size_t i = 0; i < rounds; ++i) {
+      task_coroutine_jump_fcontext(&g_main_ctx, g_switch_ctx);
+    }
+    int64_t cost = monotonic_ns() - begin;
+    r.total_ns += cost;
+    r.samples.push_back(static_cast<double>(cost) / (rounds * 2));
+  }
+  // switch_fn停在循环中，栈不释放
+  report(r);
+}
+
+// 2. spawn_join 在协程中创建batch个空协程再逐个join
+static void bench_spawn_join(size_t batch) {
+  size_t trials = std::max<size_t>(50, 100000 / batch);
+  Result r{"spawn_join", batch, trials * batch, 0, {}, ""};
+  run_in_task([&r, batch, trials]() {
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    hs.reserve(batch);
+    for (size_t t = 0; t < trials; ++t) {
+      int64_t begin = monotonic_ns();
+      for (size_t i = 0; i < batch; ++i) {
+        hs.push_back(task_coroutine::spawn([]() {}));
+      }
+      for (auto& h : hs) {
+        h.join();
+      }
+      hs.clear();
+      int64_t cost = monotonic_ns() - begin;
+      r.total_ns += cost;
+      r.samples.push_back(static_cast<double>(cost) / batch);
+    }
+  });
+  report(r);
+}
+
+// 3. yield tasks个协程各yield rounds次
+static void bench_yield(size_t tasks) {
+  constexpr size_t trials = 20;
+  size_t rounds = std::max<size_t>(100, 200000 / tasks);
+  Result r{"yield", tasks, trials * tasks * rounds, 0, {}, ""};
+  for (size_t t = 0; t < trials; ++t) {
+    int64_t begin = monotonic_ns();
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (size_t i = 0; i < tasks; ++i) {
+      hs.push_back(task_coroutine::spawn([rounds]() {
+        for (size_t k = 0; k < rounds; ++k) {
+          task_coroutine::Coroutine::yield();
+        }
+      }));
+    }
+    for (auto& h : hs) {
+      h.join();
+    }
+    int64_t cost = monotonic_ns() - begin;
+    r.total_ns += cost;
+    r.samples.push_back(static_cast<double>(cost) / (tasks * rounds));
+  }
+  report(r);
+}
+
+// 4. ping_pong pairs对协程通过信号量交替唤醒，一次操作为一个来回
+struct PingPong {
+  task_coroutine::CoSemaphore ping;
+  task_coroutine::CoSemaphore pong;
+};
+
+static void bench_ping_pong(size_t pairs) {
+  constexpr size_t trials = 20;
+  size_t rounds = std::max<size_t>(100, 100000 / pairs);
+  Result r{"ping_pong", pairs * 2, trials * pairs * rounds, 0, {}, ""};
+  for (size_t t = 0; t < trials; ++t) {
+    std::vector<PingPong> pps(pairs);
+    int64_t begin = monotonic_ns();
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (auto& pp : pps) {
+      hs.push_back(task_coroutine::spawn([&pp, rounds]() {
+        for (size_t k = 0; k < rounds; ++k) {
+          pp.ping.release();
+          pp.pong.acquire();
+        }
+      }));
+      hs.push_back(task_coroutine::spawn([&pp, rounds]() {
+        for (size_t k = 0; k < rounds; ++k) {
+          pp.ping.acquire();
+          pp.pong.release();
+        }
+      }));
+    }
+    for (auto& h : hs) {
+      h.join();
+    }
+    int64_t cost = monotonic_ns() - begin;
+    r.total_ns += cost;
+    r.samples.push_back(static_cast<double>(cost) / (pairs * rounds));
+  }
+  report(r);
+}
+
+// 5. wake_latency 从唤醒到被唤醒的协程在另一个task_group上开始运行的延迟
+// 唤醒者唤醒后忙等，被唤醒的协程只能由空闲的工作线程窃取运行；
+// 只统计两者在不同task_group的样本，忙等超时后唤醒者yield让被唤醒的协程在本地运行
+static void bench_wake_latency() {
+  constexpr size_t rounds = 5000;
+  constexpr int64_t spin_ns = 1000000;
+  Result r{"wake_latency", 2, 0, 0, {}, ""};
+  task_coroutine::CoSemaphore ping;
+  std::atomic<int64_t> wake_ns(0);
+  std::atomic<void*> waker_group(nullptr);
+  std::atomic<bool> ack(false);
+  auto waiter = task_coroutine::spawn([&]() {
+    for (size_t k = 0; k < rounds; ++k) {
+      ping.acquire();
+      int64_t latency = monotonic_ns() - wake_ns.load();
+      if (current_group() != waker_group.load()) {
+        r.samples.push_back(static_cast<double>(latency));
+        r.total_ns += latency;
+        ++r.ops;
+      }
+      ack.store(true);
+    }
+  });
+  run_in_task([&]() {
+    for (size_t k = 0; k < rounds; ++k) {
+      ack.store(false);
+      waker_group.store(current_group());
+      wake_ns.store(monotonic_ns());
+      ping.release();
+      int64_t deadline = monotonic_ns() + spin_ns;
+      while (!ack.load() && monotonic_ns() < deadline) {
+      }
+      while (!ack.load()) {
+        task_coroutine::Coroutine::yield();
+      }
+    }
+  });
+  waiter.join();
+  report(r);
+}
+
+// 6. steal 一个协程在本地队列中创建tasks个约1us的任务，之后忙等到全部完成才join，
+// 不换出，任务只能由其他工作线程窃取运行；多个工作线程时steals为0说明窃取没有工作，失败退出
+static void bench_steal(size_t tasks) {
+  constexpr size_t trials = 10;
+  Result r{"steal", tasks, trials * tasks, 0, {}, ""};
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  bool spin = tc->task_groups_num() > 1;  // 只有一个工作线程时忙等不会结束
+  task_coroutine::TaskGroupStats before = tc->total_stats();
+  run_in_task([&r, tasks, spin]() {
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    hs.reserve(tasks);
+    std::atomic<size_t> done(0);
+    for (size_t t = 0; t < trials; ++t) {
+      done.store(0);
+      int64_t begin = monotonic_ns();
+      for (size_t i = 0; i < tasks; ++i) {
+        hs.push_back(task_coroutine::spawn([&done]() {
+          int64_t end = monotonic_ns() + 1000;
+          while (monotonic_ns() < end) {
+          }
+          done.fetch_add(1);
+        }));
+      }
+      while (spin && done.load() < tasks) {
+      }
+      for (auto& h : hs) {
+        h.join();
+      }
+      hs.clear();
+      int64_t cost = monotonic_ns() - begin;
+      r.total_ns += cost;
+      r.samples.push_back(static_cast<double>(cost) / tasks);
+    }
+  });
+  task_coroutine::TaskGroupStats after = tc->total_stats();
+  size_t steals = after.steals - before.steals;
+  r.extra = ",\"steals\":" + std::to_string(steals) +
+            ",\"steal_attempts\":" +
+            std::to_string(after.steal_attempts - before.steal_attempts) +
+            ",\"migrations\":" +
+            std::to_string(after.migrations - before.migrations);
+  report(r);
+  if (spin && steals == 0) {
+    fprintf(stderr, "steal: no task was stolen with %lu workers\n",
+            tc->task_groups_num());
+    fflush(stdout);
+    _exit(1);
+  }
+}
+
+static void run_all(size_t workers) {
+  task_coroutine::TaskControlOptions options;
+  options.task_groups_num = workers;
+  options.bind_cpu = g_mode.bind_cpu;
+  options.time_slice_ms = g_mode.time_slice_ms;
+  task_coroutine::TaskControl::init(options);
+
+  bench_switch();
+  for (size_t batch : {1, 16, 256}) {
+    bench_spawn_join(batch);
+  }
+  for (size_t tasks : {workers, workers * 16, workers * 256}) {
+    bench_yield(tasks);
+  }
+  for (size_t pairs : {1ul, workers * 4, workers * 16}) {
+    bench_ping_pong(pairs);
+  }
+  if (workers > 1) {
+    bench_wake_latency();
+  }
+  for (size_t tasks : {workers * 16, workers * 1024}) {
+    bench_steal(tasks);
+  }
+}
+
+int main(int argc, char** argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "bt:")) != -1) {
+    switch (opt) {
+      case 'b':
+        g_mode.bind_cpu = true;
+        break;
+      case 't':
+        g_mode.time_slice_ms = atol(optarg);
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-b] [-t time_slice_ms] [workers...]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  std::vector<size_t> workers;
+  for (int i = optind; i < argc; ++i) {
+    workers.push_back(static_cast<size_t>(atol(argv[i])));
+  }
+  if (workers.empty()) {
+    workers = {1, 2, 4};
+  }
+  for (size_t w : workers) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      run_all(w);
+      fflush(stdout);
+      _exit(0);  // 不析构TaskControl，工作线程仍在运行
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "workers = %lu: child exited abnormally\n", w);
+      return 1;
+    }
+  }
+  return 0;
+}
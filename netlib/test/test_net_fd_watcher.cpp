@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+#include "net/fd_watcher.h"
+#include "task_coroutine/task_coroutine.h"
+
+// make_pipe/notify/drain pipe helpers, the calls are kept out of assert
+static void make_pipe(int fds[2]) {
+  int rc = pipe(fds);
+  assert(rc == 0);
+}
+
+static void notify(int fd) {
+  ssize_t n = write(fd, "x", 1);
+  assert(n == 1);
+}
+
+static void drain(int fd) {
+  char c;
+  ssize_t n = read(fd, &c, 1);
+  assert(n == 1);
+}
+
+// readiness wakes a parked coroutine and a blocked thread
+void test_ready() {
+  int fds[2];
+  make_pipe(fds);
+  auto h = task_coroutine::spawn(
+      [&fds]() { return net::FdWatcher::wait(fds[0], EPOLLIN, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  notify(fds[1]);
+  bool woken = h.join();
+  assert(woken);
+
+  // the fd stays registered, later waits re-arm it
+  for (int i = 0; i < 100; ++i) {
+    drain(fds[0]);
+    std::thread t([&fds]() { notify(fds[1]); });
+    bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 5000);
+    assert(ready);
+    t.join();
+  }
+  close(fds[0]);
+  close(fds[1]);
+
+  // the number of a closed fd is reused by a new pipe
+  make_pipe(fds);
+  notify(fds[1]);
+  bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 5000);
+  assert(ready);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// timeout returns false with errno ETIMEDOUT
+void test_timeout() {
+  int fds[2];
+  make_pipe(fds);
+  auto h = task_coroutine::spawn([&fds]() {
+    auto begin = std::chrono::steady_clock::now();
+    bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 20);
+    assert(!ready && errno == ETIMEDOUT);
+    assert(std::chrono::steady_clock::now() - begin >=
+           std::chrono::milliseconds(19));
+  });
+  h.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// a second waiter on the same fd fails with EEXIST, the first one is intact
+void test_second_waiter() {
+  int fds[2];
+  make_pipe(fds);
+  auto h = task_coroutine::spawn(
+      [&fds]() { return net::FdWatcher::wait(fds[0], EPOLLIN, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 0);
+  assert(!ready && errno == EEXIST);
+  notify(fds[1]);
+  bool woken = h.join();
+  assert(woken);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// an event that arrives after its waiter timed out does not wake a later wait
+void test_late_event() {
+  int fds[2];
+  make_pipe(fds);
+  bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 10);
+  assert(!ready && errno == ETIMEDOUT);
+  notify(fds[1]);  // fires the still armed registration
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  drain(fds[0]);
+  auto h = task_coroutine::spawn([&fds]() {
+    bool ready = net::FdWatcher::wait(fds[0], EPOLLIN, 50);
+    assert(!ready && errno == ETIMEDOUT);
+  });
+  h.join();
+  close(fds[0]);
+  close(fds[1]);
+}
+
+int main(int argc, char** argv) {
+  test_ready();
+  test_timeout();
+  test_second_waiter();
+  test_late_event();
+  printf("access test\n");
+  return 0;
+}
@@ -1,10 +1,23 @@
 #include <assert.h>
 #include <stdio.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unwind.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "task_coroutine/task_coroutine.h"
 
@@ -38,7 +51,919 @@ void* foo(void* arg) {
   return nullptr;
 }
 
+// deep 递归消耗约depth KB栈
+size_t deep(size_t depth) {
+  volatile char buf[1024];
+  buf[0] = static_cast<char>(depth);
+  return depth == 0 ? buf[0] : deep(depth - 1) + buf[0];
+}
+
+void* deep_fn(void* arg) {
+  deep(*static_cast<size_t*>(arg));
+  return nullptr;
+}
+
+// 不同栈大小类别的协程
+void test_stack_type() {
+  size_t small_depth = 2, large_depth = 512;
+  task_coroutine::Coroutine c1(deep_fn, &small_depth,
+                               task_coroutine::StackType::SMALL);
+  task_coroutine::Coroutine c2(deep_fn, &large_depth,
+                               task_coroutine::StackType::LARGE);
+  c1.join();
+  c2.join();
+}
+
+// resident_bytes [memory, memory + len)中有物理页的字节数
+static size_t resident_bytes(void* memory, size_t len) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  std::vector<unsigned char> vec((len + page - 1) / page);
+  assert(mincore(memory, len, vec.data()) == 0);
+  return std::count_if(vec.begin(), vec.end(),
+                       [](unsigned char v) { return (v & 1) != 0; }) *
+         page;
+}
+
+// COMPACT栈：调用很深之后park，只占用park时实际使用的栈；栈上的等待者和局部变量在park期间有效
+void test_compact_stack() {
+  constexpr int n = 1000;
+  task_coroutine::CoSemaphore sem;
+  std::atomic<int> parked(0);
+  std::atomic<int> ok(0);
+  std::vector<void*> stacks(n);
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < n; ++i) {
+    hs.push_back(task_coroutine::spawn(
+        [&, i]() {
+          stacks[i] = task_coroutine::TaskGroup::current_task()->memory;
+          deep(48);
+          int local[16];
+          for (int& x : local) {
+            x = i;
+          }
+          parked.fetch_add(1);
+          sem.acquire();
+          if (std::all_of(std::begin(local), std::end(local),
+                          [i](int x) { return x == i; })) {
+            ok.fetch_add(1);
+          }
+        },
+        task_coroutine::StackType::COMPACT));
+  }
+  while (parked.load() < n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  size_t resident = 0;
+  for (void* m : stacks) {
+    resident += resident_bytes(
+        m, task_coroutine::stack_size(task_coroutine::StackType::COMPACT));
+  }
+  assert(resident / n < 16 * 1024);  // 没有trim时约52KB
+  sem.release(n);
+  for (auto& h : hs) {
+    h.join();
+  }
+  assert(ok.load() == n);
+}
+
+// run_in_child 在子进程中用options创建TaskControl并运行fn，返回waitpid的状态，子进程的stderr保存在err中
+// 需要在当前进程创建TaskControl之前调用，fork之后子进程中只有调用线程
+static int run_in_child(const task_coroutine::TaskControlOptions& options,
+                        void (*fn)(), std::string* err) {
+  int fds[2];
+  assert(pipe(fds) == 0);
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    close(fds[0]);
+    dup2(fds[1], STDERR_FILENO);
+    task_coroutine::TaskControl::init(options);
+    fn();
+    _exit(0);
+  }
+  close(fds[1]);
+  char buf[256];
+  ssize_t n;
+  while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+    err->append(buf, n);
+  }
+  close(fds[0]);
+  int status = 0;
+  assert(waitpid(pid, &status, 0) == pid);
+  return status;
+}
+
+// run_in_child 在子进程中用workers个工作线程运行fn
+static int run_in_child(size_t workers, void (*fn)(), std::string* err) {
+  task_coroutine::TaskControlOptions options;
+  options.task_groups_num = workers;
+  return run_in_child(options, fn, err);
+}
+
+// 默认选项：工作线程数等于进程CPU亲和性掩码中的CPU数
+static void default_options() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  int rc = sched_getaffinity(0, sizeof(set), &set);
+  assert(rc == 0);
+  assert(task_coroutine::TaskControl::get()->task_groups_num() ==
+         static_cast<size_t>(CPU_COUNT(&set)));
+}
+
+// bind_cpu：第i个工作线程绑定到可用CPU中的第i % n个，协程总是运行在所在工作线程绑定的CPU上
+static void bound_cpus() {
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  std::vector<int> cpus = task_coroutine::TaskControl::available_cpus();
+  assert(!cpus.empty());
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < 64; ++i) {
+    hs.push_back(task_coroutine::spawn([tc, &cpus]() {
+      for (int j = 0; j < 10; ++j) {
+        size_t idx = 0;
+        while (tc->task_group(idx) != task_coroutine::tls_task_group) {
+          ++idx;
+          assert(idx < tc->task_groups_num());
+        }
+        int cpu = cpus[idx % cpus.size()];
+        assert(sched_getcpu() == cpu);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        int rc = sched_getaffinity(0, sizeof(set), &set);
+        assert(rc == 0 && CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set));
+        task_coroutine::Coroutine::yield();  // 可能在其他工作线程上恢复
+      }
+    }));
+  }
+  for (auto& h : hs) {
+    h.join();
+  }
+}
+
+void test_options() {
+  std::string err;
+  int status = run_in_child(0, default_options, &err);  // 0表示默认工作线程数
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  task_coroutine::TaskControlOptions options;
+  options.task_groups_num =
+      task_coroutine::TaskControl::available_cpus().size() * 2;
+  options.bind_cpu = true;
+  status = run_in_child(options, bound_cpus, &err);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+// 有保护页的栈溢出：访问到保护页时报告栈溢出，以SIGSEGV终止
+static void guarded_overflow() {
+  size_t depth = 64;  // 约64KB，SMALL栈为8KB
+  task_coroutine::Coroutine c(deep_fn, &depth, task_coroutine::StackType::SMALL);
+  c.join();
+}
+
+void test_guarded_overflow() {
+  std::string err;
+  int status = run_in_child(1, guarded_overflow, &err);
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+  assert(err.find("stack overflow") != std::string::npos);
+}
+
+// COMPACT栈溢出到相邻的栈：相邻栈的标记被覆盖，下次切换到它时终止进程
+// low一直yield，不在栈上登记等待者，被覆盖的栈不会在切换之前被其他线程访问
+static void compact_overflow() {
+  using task_coroutine::StackType;
+  static std::atomic<bool> done(false);
+  // 新进程中连续分配的两个COMPACT栈在同一个slab中相邻，后一个的地址更高
+  auto low = task_coroutine::spawn(
+      []() {
+        while (!done.load()) {
+          task_coroutine::Coroutine::yield();
+        }
+      },
+      StackType::COMPACT);
+  auto high = task_coroutine::spawn(
+      []() {
+        volatile char buf[(64 + 4) * 1024];  // COMPACT栈为64KB
+        for (size_t i = 0; i < sizeof(buf); ++i) {
+          buf[i] = 1;
+        }
+      },
+      StackType::COMPACT);
+  high.join();
+  done.store(true);
+  low.join();
+}
+
+void test_compact_overflow() {
+  std::string err;
+  int status = run_in_child(1, compact_overflow, &err);
+#ifdef TASK_COROUTINE_ASAN
+  // ASan在写入相邻栈上的红区时先报告
+  assert(WIFEXITED(status) && WEXITSTATUS(status) != 0);
+  assert(err.find("AddressSanitizer") != std::string::npos);
+#else
+  assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+  assert(err.find("stack overflow") != std::string::npos);
+#endif
+}
+
+// runnext公平性：两个协程互相唤醒时，先进入队列的协程仍然能够运行
+struct FairnessArg {
+  task_coroutine::CoSemaphore ping;
+  task_coroutine::CoSemaphore pong;
+  std::atomic<bool> stop{false};
+  bool done = false;
+  size_t rounds = 0;
+};
+
+void* fairness_ping(void* arg) {
+  FairnessArg* fa = static_cast<FairnessArg*>(arg);
+  for (; fa->rounds < 10000000; ++fa->rounds) {
+    if (fa->stop.load()) {
+      break;
+    }
+    fa->ping.release();
+    fa->pong.acquire();
+  }
+  fa->done = true;
+  fa->ping.release();
+  return nullptr;
+}
+
+void* fairness_pong(void* arg) {
+  FairnessArg* fa = static_cast<FairnessArg*>(arg);
+  for (;;) {
+    fa->ping.acquire();
+    if (fa->done) {
+      break;
+    }
+    fa->pong.release();
+  }
+  return nullptr;
+}
+
+void* fairness_stop(void* arg) {
+  static_cast<FairnessArg*>(arg)->stop.store(true);
+  return nullptr;
+}
+
+void* fairness_fn(void* arg) {
+  FairnessArg* fa = static_cast<FairnessArg*>(arg);
+  // 后进先出：stop最后运行，只有runnext让出时才能运行
+  task_coroutine::Coroutine stop(fairness_stop, fa);
+  task_coroutine::Coroutine ping(fairness_ping, fa);
+  task_coroutine::Coroutine pong(fairness_pong, fa);
+  ping.join();
+  pong.join();
+  stop.join();
+  return nullptr;
+}
+
+void test_runnext_fairness() {
+  FairnessArg fa;
+  task_coroutine::Coroutine c(fairness_fn, &fa);
+  c.join();
+  assert(fa.stop.load() && fa.rounds < 10000000);
+}
+
+// 批量创建：每个协程运行一次，参数正确
+void* count_fn(void* arg) {
+  static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+  return nullptr;
+}
+
+void* spawn_n_fn(void* arg) {
+  std::vector<std::atomic<int>>& counts =
+      *static_cast<std::vector<std::atomic<int>>*>(arg);
+  std::vector<void*> args;
+  for (auto& c : counts) {
+    args.push_back(&c);
+  }
+  auto cs = task_coroutine::Coroutine::spawn_n(args.size(), count_fn,
+                                               args.data());
+  for (auto& c : cs) {
+    c.join();
+  }
+  return nullptr;
+}
+
+void test_spawn_n() {
+  // 非工作线程中创建
+  std::vector<std::atomic<int>> counts(1000);
+  spawn_n_fn(&counts);
+  // 工作线程中创建
+  task_coroutine::Coroutine c(spawn_n_fn, &counts);
+  c.join();
+  for (auto& c : counts) {
+    assert(c.load() == 2);
+  }
+
+  std::atomic<int> sum(0);
+  std::vector<std::function<void()>> fns;
+  for (int i = 1; i <= 100; ++i) {
+    fns.push_back([&sum, i]() { sum.fetch_add(i); });
+  }
+  auto cs = task_coroutine::Coroutine::spawn(fns.begin(), fns.end());
+  for (auto& c : cs) {
+    c.join();
+  }
+  assert(sum.load() == 5050);
+}
+
+// 可调用对象：捕获的状态构造在协程栈顶，join返回返回值
+struct MoveOnly {
+  std::unique_ptr<int> v;
+  std::atomic<int>* destroyed;
+  MoveOnly(int x, std::atomic<int>* d) : v(new int(x)), destroyed(d) {}
+  MoveOnly(MoveOnly&&) = default;
+  ~MoveOnly() {
+    if (v != nullptr) {
+      destroyed->fetch_add(1);
+    }
+  }
+};
+
+void test_spawn_callable() {
+  auto h1 = task_coroutine::spawn([]() { return 42; });
+  assert(h1.valid());
+  assert(h1.join() == 42);
+
+  std::atomic<int> destroyed(0);
+  MoveOnly m(7, &destroyed);
+  auto h2 = task_coroutine::spawn(
+      [m = std::move(m)]() { return std::to_string(*m.v); });
+  assert(h2.join() == "7");
+  assert(destroyed.load() == 1);  // 捕获的状态在协程中析构
+
+  // 嵌套创建、较大的捕获、void返回值
+  std::array<int, 256> arr;
+  arr.fill(1);
+  auto h3 = task_coroutine::spawn([arr]() {
+    auto inner = task_coroutine::spawn([arr]() {
+      int sum = 0;
+      for (int x : arr) {
+        sum += x;
+      }
+      return sum;
+    });
+    assert(inner.join() == 256);
+  });
+  h3.join();
+
+  // 不join，句柄析构后协程照常完成
+  std::atomic<int> done(0);
+  {
+    auto h4 = task_coroutine::spawn([&done]() { done.store(1); });
+  }
+  while (done.load() == 0) {
+    std::this_thread::yield();
+  }
+}
+
+// 非工作线程创建：多个外部线程同时创建协程，放入全局注入队列
+void test_inject() {
+  std::atomic<int> done(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&done]() {
+      std::vector<task_coroutine::Coroutine> cs;
+      for (int i = 0; i < 500; ++i) {
+        cs.emplace_back(
+            [](void* arg) -> void* {
+              static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+              return nullptr;
+            },
+            &done);
+        auto h = task_coroutine::spawn([&done]() { done.fetch_add(1); });
+        h.join();
+      }
+      std::vector<void*> args(500, &done);
+      auto batch = task_coroutine::Coroutine::spawn_n(
+          args.size(),
+          [](void* arg) -> void* {
+            static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+            return nullptr;
+          },
+          args.data());
+      for (auto& c : cs) {
+        c.join();
+      }
+      for (auto& c : batch) {
+        c.join();
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  assert(done.load() == 4 * 1500);
+
+  // 工作线程一直有任务（互相唤醒）时，仍然会轮询到注入队列
+  struct PingPong {
+    task_coroutine::CoSemaphore ping, pong;
+    std::atomic<bool> stop{false}, finished{false};
+  } pp;
+  auto h1 = task_coroutine::spawn([&pp]() {
+    while (!pp.stop.load()) {
+      pp.ping.release();
+      pp.pong.acquire();
+    }
+    pp.finished.store(true);
+    pp.ping.release();
+  });
+  auto h2 = task_coroutine::spawn([&pp]() {
+    for (;;) {
+      pp.ping.acquire();
+      if (pp.finished.load()) {
+        break;
+      }
+      pp.pong.release();
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto stopper = task_coroutine::spawn([&pp]() { pp.stop.store(true); });
+  stopper.join();
+  h1.join();
+  h2.join();
+}
+
+// 优先级：I/O任务先于批处理任务运行，批处理任务不会被一直让出的I/O任务饿死
+// 在只有一个工作线程的子进程中运行，按权重I/O任务全部先于批处理任务运行
+static void priority_order() {
+  using task_coroutine::TaskPriority;
+  auto h = task_coroutine::spawn([]() {
+    std::atomic<int> seq(0);
+    std::vector<int> batch_order(64), io_order(8);
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (int i = 0; i < 64; ++i) {
+      hs.push_back(task_coroutine::spawn(
+          [&, i]() { batch_order[i] = seq.fetch_add(1); }, TaskPriority::BATCH));
+    }
+    for (int i = 0; i < 8; ++i) {
+      hs.push_back(task_coroutine::spawn(
+          [&, i]() { io_order[i] = seq.fetch_add(1); }, TaskPriority::IO));
+    }
+    for (auto& h : hs) {
+      h.join();
+    }
+    hs.clear();
+    for (int x : io_order) {
+      assert(x < 8);
+    }
+
+    std::atomic<bool> batch_done(false);
+    for (int i = 0; i < 4; ++i) {
+      hs.push_back(task_coroutine::spawn(
+          [&]() {
+            while (!batch_done.load()) {
+              task_coroutine::Coroutine::yield();
+            }
+          },
+          TaskPriority::IO));
+    }
+    hs.push_back(task_coroutine::spawn([&]() { batch_done.store(true); },
+                                       TaskPriority::BATCH));
+    for (auto& h : hs) {
+      h.join();
+    }
+  });
+  h.join();
+}
+
+void test_priority() {
+  std::string err;
+  int status = run_in_child(1, priority_order, &err);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+// 调度统计：在非工作线程读取，不暂停工作线程
+void test_stats() {
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  task_coroutine::TaskGroupStats before = tc->total_stats();
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < 1000; ++i) {
+    hs.push_back(task_coroutine::spawn([]() {
+      task_coroutine::Coroutine::yield();
+    }));
+  }
+  for (auto& h : hs) {
+    h.join();
+  }
+  task_coroutine::TaskGroupStats after = tc->total_stats();
+  assert(after.tasks_run - before.tasks_run >= 1000);
+  // 每个协程至少切换两次：开始运行和yield后重新运行
+  assert(after.context_switches - before.context_switches >= 2000);
+  assert(after.steals <= after.steal_attempts);
+  assert(after.idle_ns + after.running_ns > 0);
+  std::vector<task_coroutine::TaskGroupStats> per_group = tc->stats();
+  assert(per_group.size() == tc->task_groups_num());
+  task_coroutine::TaskGroupStats sum;
+  for (auto& s : per_group) {
+    sum += s;
+  }
+  assert(sum.tasks_run >= after.tasks_run);
+}
+
+// 监控线程：协程运行超过时间片时设置should_yield，热循环中maybe_yield让出
+void test_watchdog() {
+  auto h1 = task_coroutine::spawn([]() {
+    int64_t begin = task_coroutine::monotonic_ns();
+    while (!task_coroutine::Coroutine::should_yield()) {
+      assert(task_coroutine::monotonic_ns() - begin < 10000000000);
+    }
+    task_coroutine::Coroutine::yield();
+    assert(!task_coroutine::Coroutine::should_yield());  // 重新调度时清除
+  });
+  h1.join();
+
+  // 只有一个工作线程时，b只有在a让出之后才能运行
+  std::atomic<bool> b_ran(false);
+  auto a = task_coroutine::spawn([&b_ran]() {
+    task_coroutine::YieldCounter counter(64);
+    while (!b_ran.load()) {
+      counter.tick();
+    }
+  });
+  auto b = task_coroutine::spawn([&b_ran]() { b_ran.store(true); });
+  a.join();
+  b.join();
+}
+
+void test_offload() {
+  // 非工作线程直接调用
+  assert(task_coroutine::offload([]() { return 7; }) == 7);
+
+  auto h1 = task_coroutine::spawn([]() {
+    int x = 0;
+    task_coroutine::offload([&x]() { x = 1; });
+    assert(x == 1);
+    std::string s = task_coroutine::offload([]() { return std::string("abc"); });
+    assert(s == "abc");
+  });
+  h1.join();
+
+  // 卸载的阻塞调用不占用工作线程，只有一个工作线程时其他协程也能继续运行
+  std::atomic<bool> done(false);
+  std::atomic<int> ticks(0);
+  auto blocker = task_coroutine::spawn([&done]() {
+    task_coroutine::offload(
+        []() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+    done.store(true);
+  });
+  auto ticker = task_coroutine::spawn([&done, &ticks]() {
+    while (!done.load()) {
+      ticks.fetch_add(1);
+      task_coroutine::Coroutine::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  blocker.join();
+  ticker.join();
+  assert(ticks.load() > 1);
+
+  // 多个阻塞调用并发运行
+  constexpr int n = 16;
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<task_coroutine::JoinHandle<int>> hs;
+  for (int i = 0; i < n; ++i) {
+    hs.push_back(task_coroutine::spawn([i]() {
+      return task_coroutine::offload([i]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return i;
+      });
+    }));
+  }
+  for (int i = 0; i < n; ++i) {
+    assert(hs[i].join() == i);
+  }
+  auto cost = std::chrono::steady_clock::now() - begin;
+  assert(cost < std::chrono::milliseconds(100 * n / 2));
+}
+
+void test_handoff() {
+  // 阻塞调用中的协程之前创建的任务在本地队列中，由临时线程接手运行，
+  // 只有一个工作线程时也能在阻塞调用返回之前完成
+  std::atomic<bool> blocking_done(false);
+  std::atomic<int> finished(0);
+  std::atomic<int> finished_while_blocking(0);
+  constexpr int n = 10;
+  auto blocker = task_coroutine::spawn([&]() {
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (int i = 0; i < n; ++i) {
+      hs.push_back(task_coroutine::spawn([&]() {
+        task_coroutine::Coroutine::sleep_for(std::chrono::milliseconds(1));
+        if (!blocking_done.load()) {
+          finished_while_blocking.fetch_add(1);
+        }
+        finished.fetch_add(1);
+      }));
+    }
+    task_coroutine::blocking([]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    });
+    blocking_done.store(true);
+    for (auto& h : hs) {
+      h.join();
+    }
+  });
+  blocker.join();
+  assert(finished.load() == n);
+  assert(finished_while_blocking.load() == n);
+
+  // 临时线程空闲后退出
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  for (int i = 0; i < 1000 && tc->spare_threads_num() > 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  assert(tc->spare_threads_num() == 0);
+
+  // 临时线程上运行的协程超时等待，提前被唤醒取消了定时任务，临时线程不等到原来的超时时间
+  task_coroutine::CoSemaphore sem;
+  std::atomic<int> waiting(0);
+  blocker = task_coroutine::spawn([&]() {
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (int i = 0; i < n; ++i) {
+      hs.push_back(task_coroutine::spawn([&]() {
+        waiting.fetch_add(1);
+        bool acquired = sem.try_acquire_for(std::chrono::seconds(10));
+        assert(acquired);
+        (void)acquired;
+      }));
+    }
+    task_coroutine::blocking([&]() {
+      for (int i = 0; i < 1000 && waiting.load() < n; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      sem.release(n);
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    for (auto& h : hs) {
+      h.join();
+    }
+  });
+  blocker.join();
+  for (int i = 0; i < 1000 && tc->spare_threads_num() > 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  assert(tc->spare_threads_num() == 0);
+}
+
+// wait_count 在非工作线程等待n达到expected
+static bool wait_count(const std::atomic<int>& n, int expected) {
+  for (int i = 0; i < 5000 && n.load() < expected; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return n.load() == expected;
+}
+
+void test_post() {
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  task_coroutine::TaskGroupStats before = tc->total_stats();
+  std::atomic<int> n(0);
+  // 非工作线程投递，放入全局注入队列
+  for (int i = 0; i < 1000; ++i) {
+    task_coroutine::post([&n]() { n.fetch_add(1); });
+  }
+  assert(wait_count(n, 1000));
+
+  // 协程中投递、无栈任务中继续投递，与协程交替运行；
+  // 无栈任务中yield什么也不做，不在协程中
+  n.store(0);
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < 100; ++i) {
+    hs.push_back(task_coroutine::spawn([&n]() {
+      for (int j = 0; j < 10; ++j) {
+        task_coroutine::post([&n]() {
+          task_coroutine::Coroutine::yield();
+          task_coroutine::post([&n]() { n.fetch_add(1); },
+                               task_coroutine::TaskPriority::BATCH);
+        });
+      }
+    }));
+  }
+  for (auto& h : hs) {
+    h.join();
+  }
+  assert(wait_count(n, 1000));
+
+  // 可调用对象超过描述符中的存储时在堆上构造
+  char big[task_coroutine::STACKLESS_STORAGE_SIZE * 2] = {1};
+  std::atomic<int> sum(0);
+  bool posted = task_coroutine::post([big, &sum]() { sum.fetch_add(big[0]); });
+  assert(posted);
+  assert(wait_count(sum, 1));
+
+  task_coroutine::TaskGroupStats after = tc->total_stats();
+  assert(after.stackless_run - before.stackless_run >= 3001);
+}
+
+// cpu_ns 进程到目前为止使用的CPU时间（用户态+内核态）
+static int64_t cpu_ns() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000LL +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+// wait_all_idle 等待所有工作线程登记为空闲
+static bool wait_all_idle() {
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  for (int i = 0; i < 5000; ++i) {
+    if (tc->idle_num() == tc->task_groups_num()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+// 空闲的工作线程park：先unpark后park不丢失唤醒，突发的任务唤醒park的工作线程，空闲时几乎不占用CPU
+void test_parking() {
+  // 许可：先unpark后park立即返回；许可不累加
+  task_coroutine::ParkingLot lot;
+  lot.unpark();
+  lot.park();
+  std::thread t([&lot]() { lot.unpark(); });
+  t.join();
+  lot.park();
+  lot.unpark();
+  lot.unpark();
+  bool got = lot.park_until(task_coroutine::monotonic_ns() + 1000000000);
+  assert(got);
+  got = lot.park_until(task_coroutine::monotonic_ns() + 10000000);
+  assert(!got);
+
+  // 空闲：所有工作线程park，200ms内几乎不使用CPU，也不反复park
+  task_coroutine::TaskControl* tc = task_coroutine::TaskControl::get();
+  assert(wait_all_idle());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));  // 到期的定时任务
+  task_coroutine::TaskGroupStats before = tc->total_stats();
+  int64_t cpu_begin = cpu_ns();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  int64_t cpu_used = cpu_ns() - cpu_begin;
+  task_coroutine::TaskGroupStats after = tc->total_stats();
+  assert(cpu_used < 20000000);
+  assert(after.parks - before.parks <= tc->task_groups_num());
+  assert(after.tasks_run == before.tasks_run);
+
+  // 突发：非工作线程批量注入、协程中批量创建，park的工作线程被唤醒，所有任务都运行
+  before = after;
+  std::atomic<int> n(0);
+  std::vector<void*> args(1000, &n);
+  auto batch = task_coroutine::Coroutine::spawn_n(
+      args.size(),
+      [](void* arg) -> void* {
+        static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+        return nullptr;
+      },
+      args.data());
+  for (auto& c : batch) {
+    c.join();
+  }
+  assert(wait_all_idle());
+  auto h = task_coroutine::spawn([&args]() {
+    auto inner = task_coroutine::Coroutine::spawn_n(
+        args.size(),
+        [](void* arg) -> void* {
+          static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+          return nullptr;
+        },
+        args.data());
+    for (auto& c : inner) {
+      c.join();
+    }
+  });
+  h.join();
+  assert(n.load() == 2000);
+  after = tc->total_stats();
+  assert(after.tasks_run - before.tasks_run >= 2001);
+  assert(after.unparks - before.unparks >= 2);  // 两次突发各至少唤醒一个工作线程
+  assert(after.parks >= after.unparks);
+}
+
+// join：非工作线程阻塞在futex上不占用CPU；协程等待者只被恢复一次
+void test_join_wait() {
+  auto h = task_coroutine::spawn([]() {
+    task_coroutine::Coroutine::sleep_for(std::chrono::milliseconds(100));
+  });
+  int64_t begin = task_coroutine::monotonic_ns();
+  int64_t cpu_begin = cpu_ns();
+  h.join();
+  int64_t cpu_used = cpu_ns() - cpu_begin;
+  assert(task_coroutine::monotonic_ns() - begin >= 90000000);
+  assert(cpu_used < 20000000);
+
+  // 被等待的协程与等待者的登记同时完成：一半立即完成，一半yield后完成
+  constexpr int n = 1000;
+  std::atomic<int> resumed(0);
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < n; ++i) {
+    hs.push_back(task_coroutine::spawn([i, &resumed]() {
+      auto target = task_coroutine::spawn([i]() {
+        if (i % 2 == 0) {
+          task_coroutine::Coroutine::yield();
+        }
+      });
+      target.join();
+      resumed.fetch_add(1);  // 恢复两次时会再次执行
+    }));
+  }
+  for (auto& h : hs) {
+    h.join();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));  // 迟到的重复唤醒
+  assert(resumed.load() == n);
+}
+
+// 无栈任务中的等待不换出，阻塞工作线程（标记为阻塞调用）直到被唤醒
+// 唤醒者为非工作线程，不依赖临时线程接手
+void test_post_wait() {
+  task_coroutine::CoMutex mu;
+  task_coroutine::Channel<int> ch;
+  std::atomic<int> n(0);
+  mu.lock();
+  for (int i = 0; i < 4; ++i) {
+    task_coroutine::post([&]() {
+      assert(task_coroutine::TaskGroup::current_task() == nullptr);
+      mu.lock();  // 等待非工作线程unlock
+      int v = 0;
+      if (ch.recv(v)) {  // 等待非工作线程send
+        n.fetch_add(v);
+      }
+      mu.unlock();
+      task_coroutine::Coroutine::sleep_for(std::chrono::milliseconds(1));
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  mu.unlock();
+  for (int i = 0; i < 4; ++i) {
+    assert(ch.send(1));  // 无缓冲，等待接收者
+  }
+  assert(wait_count(n, 4));
+}
+
+static _Unwind_Reason_Code count_frame(struct _Unwind_Context*, void* arg) {
+  ++*static_cast<int*>(arg);
+  return _URC_NO_REASON;
+}
+
+// check_unwind 协程中基于CFI和基于帧指针的回溯都在协程栈的最外层帧正常结束
+static void check_unwind() {
+  int frames = 0;
+  assert(_Unwind_Backtrace(count_frame, &frames) == _URC_END_OF_STACK);
+  assert(frames >= 3 && frames < 64);
+#ifndef __OPTIMIZE__  // 优化编译时省略帧指针，rbp不构成链表
+  void** fp = static_cast<void**>(__builtin_frame_address(0));
+  int depth = 0;
+  while (fp != nullptr) {
+    void** next = static_cast<void**>(fp[0]);
+    assert(next == nullptr || next > fp);
+    fp = next;
+    assert(++depth < 64);
+  }
+#endif
+}
+
+void test_unwind() {
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  for (int i = 0; i < 100; ++i) {
+    task_coroutine::TaskAttr attr(i % 2 == 0 ? task_coroutine::StackType::NORMAL
+                                             : task_coroutine::StackType::COMPACT);
+    hs.push_back(task_coroutine::spawn(
+        []() {
+          check_unwind();
+          task_coroutine::Coroutine::yield();  // 可能在其他工作线程上恢复
+          check_unwind();
+        },
+        attr));
+  }
+  for (auto& h : hs) {
+    h.join();
+  }
+}
+
 int main(int argc, char** argv) {
+  // fork子进程的测试在创建TaskControl之前运行
+  test_guarded_overflow();
+  test_compact_overflow();
+  test_priority();
+  test_options();
+
+  test_stack_type();
+  test_compact_stack();
+  test_inject();
+  test_stats();
+  test_watchdog();
+  test_offload();
+  test_handoff();
+  test_parking();
+  test_join_wait();
+  test_post();
+  test_post_wait();
+  test_unwind();
+  test_spawn_callable();
+  test_spawn_n();
+  test_runnext_fairness();
+
   std::vector<task_coroutine::Coroutine> cs;
   for (int j = 0; j < 10000; ++j) {
     cs.emplace_back(foo, new int(j));
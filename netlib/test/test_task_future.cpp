@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "task_coroutine/task_future.h"
+
+using task_coroutine::async;
+using task_coroutine::Coroutine;
+using task_coroutine::Future;
+using task_coroutine::Promise;
+using task_coroutine::spawn;
+using task_coroutine::when_all;
+using task_coroutine::when_any;
+
+// Promise/Future: 协程中等待，非工作线程中设置值
+void test_promise() {
+  Promise<int> p;
+  Future<int> f = p.get_future();
+  assert(f.valid() && !f.ready());
+  auto h = spawn([f]() { return f.get() + 1; });
+  std::thread t([&p]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    p.set_value(41);
+  });
+  assert(h.join() == 42);
+  t.join();
+  assert(f.has_value() && f.get() == 41);
+
+  // 非工作线程中等待
+  Future<std::string> s = async([]() {
+    Coroutine::sleep_for(std::chrono::milliseconds(5));
+    return std::string("hello");
+  });
+  assert(s.get() == "hello");
+
+  Future<void> v = async([]() {});
+  v.wait();
+  assert(v.has_value());
+}
+
+// broken promise: Promise未设置值就析构
+void test_broken_promise() {
+  Future<int> f;
+  {
+    Promise<int> p;
+    f = p.get_future();
+  }
+  assert(f.ready() && !f.has_value());
+  // then不运行后续任务，返回的Future同样没有值
+  std::atomic<bool> called(false);
+  Future<int> g = f.then([&called](int x) {
+    called = true;
+    return x;
+  });
+  g.wait();
+  assert(!g.has_value() && !called);
+}
+
+// then: 后续任务在新的协程中运行，可以阻塞，可以链式调用
+void test_then() {
+  Promise<int> p;
+  Future<std::string> f =
+      p.get_future()
+          .then([](int x) {
+            Coroutine::sleep_for(std::chrono::milliseconds(1));
+            return x * 2;
+          })
+          .then([](const int& x) { return std::to_string(x); });
+  assert(!f.ready());
+  p.set_value(21);
+  assert(f.get() == "42");
+
+  // 已经就绪时调用then，只能移动的可调用对象
+  std::unique_ptr<int> u(new int(7));
+  std::atomic<int> seen(0);
+  Future<void> v = async([]() { return 1; }).then(
+      [u = std::move(u), &seen](int x) { seen = *u + x; });
+  v.get();
+  assert(seen == 8);
+  assert(v.then([]() { return 3; }).get() == 3);
+}
+
+// wait_for: 超时返回false，之后仍然可以等待
+void test_wait_for() {
+  Promise<int> p;
+  Future<int> f = p.get_future();
+  auto h = spawn([f]() {
+    int64_t begin = task_coroutine::monotonic_ns();
+    bool ok = f.wait_for(std::chrono::milliseconds(20));
+    assert(task_coroutine::monotonic_ns() - begin >= 20 * 1000000);
+    return ok;
+  });
+  assert(!h.join());
+  assert(!f.wait_for(std::chrono::milliseconds(1)));
+  p.set_value(1);
+  assert(f.wait_for(std::chrono::milliseconds(1)));
+  assert(f.get() == 1);
+}
+
+// when_all: 扇出N个子任务，全部完成后按顺序汇总
+void test_when_all() {
+  std::vector<Future<int>> fs;
+  for (int i = 0; i < 100; ++i) {
+    fs.push_back(async([i]() {
+      Coroutine::sleep_for(std::chrono::milliseconds(100 - i % 10));
+      return i * i;
+    }));
+  }
+  std::vector<int> values = when_all(fs).get();
+  assert(values.size() == 100);
+  for (int i = 0; i < 100; ++i) {
+    assert(values[i] == i * i);
+  }
+
+  std::atomic<int> done(0);
+  std::vector<Future<void>> vs;
+  for (int i = 0; i < 100; ++i) {
+    vs.push_back(async([&done]() { done.fetch_add(1); }));
+  }
+  when_all(vs).get();
+  assert(done == 100);
+
+  assert(when_all(std::vector<Future<int>>()).get().empty());
+
+  // 任意一个没有值，结果没有值
+  Future<std::vector<int>> r;
+  {
+    Promise<int> p1, p2;
+    r = when_all(std::vector<Future<int>>{p1.get_future(), p2.get_future()});
+    p1.set_value(1);
+    assert(!r.ready());
+  }
+  assert(r.ready() && !r.has_value());
+}
+
+// when_any: 前K个完成即返回，配合wait_for实现超时
+void test_when_any() {
+  std::vector<Promise<int>> ps(10);
+  std::vector<Future<int>> fs;
+  for (auto& p : ps) {
+    fs.push_back(p.get_future());
+  }
+  Future<std::vector<size_t>> first = when_any(fs);
+  Future<std::vector<size_t>> first3 = when_any(fs, 3);
+  assert(!first3.wait_for(std::chrono::milliseconds(5)));
+  ps[7].set_value(7);
+  assert(first.get() == std::vector<size_t>{7});
+  ps[2].set_value(2);
+  assert(!first3.ready());
+  ps[5].set_value(5);
+  assert((first3.get() == std::vector<size_t>{7, 2, 5}));
+  for (size_t i : first3.get()) {
+    assert(fs[i].get() == static_cast<int>(i));
+  }
+  // k大于个数时等待全部就绪
+  Future<std::vector<size_t>> all = when_any(fs, 100);
+  for (size_t i = 0; i < ps.size(); ++i) {
+    if (!fs[i].ready()) {
+      ps[i].set_value(static_cast<int>(i));
+    }
+  }
+  assert(all.get().size() == 10);
+  assert(when_any(fs, 0).get().empty());
+
+  // 协程中扇出，快的子任务先完成
+  auto h = spawn([]() {
+    std::vector<Future<int>> fs;
+    for (int i = 0; i < 8; ++i) {
+      fs.push_back(async([i]() {
+        Coroutine::sleep_for(std::chrono::milliseconds(i == 3 ? 1 : 200));
+        return i;
+      }));
+    }
+    std::vector<size_t> idx = when_any(fs).get();
+    when_all(fs).wait();
+    return idx[0];
+  });
+  assert(h.join() == 3);
+}
+
+// 多个等待者与设置值竞争
+void test_race() {
+  for (int round = 0; round < 100; ++round) {
+    Promise<int> p;
+    Future<int> f = p.get_future();
+    std::atomic<int> sum(0);
+    std::vector<Coroutine> cs;
+    auto fn = [f, &sum]() { sum.fetch_add(f.get()); };
+    std::vector<decltype(fn)> fns(16, fn);
+    cs = Coroutine::spawn(fns.begin(), fns.end());
+    Future<int> chained = f.then([](int x) { return x + 1; });
+    p.set_value(1);
+    for (auto& c : cs) {
+      c.join();
+    }
+    assert(sum == 16);
+    assert(chained.get() == 2);
+  }
+}
+
+int main() {
+  test_promise();
+  test_broken_promise();
+  test_then();
+  test_wait_for();
+  test_when_all();
+  test_when_any();
+  test_race();
+  printf("access test\n");
+  return 0;
+}
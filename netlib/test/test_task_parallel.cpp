@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "task_coroutine/task_parallel.h"
+
+using task_coroutine::parallel_for;
+using task_coroutine::parallel_for_each;
+using task_coroutine::parallel_reduce;
+using task_coroutine::parallel_sort;
+using task_coroutine::parallel_transform;
+
+void test_for() {
+  std::vector<int> v(1000000, 1);
+  parallel_for(0, v.size(), [&v](size_t i) { v[i] += static_cast<int>(i % 7); });
+  for (size_t i = 0; i < v.size(); ++i) {
+    assert(v[i] == 1 + static_cast<int>(i % 7));
+  }
+
+  // 空区间、单个元素、指定粒度
+  std::atomic<int> n(0);
+  parallel_for(5, 5, [&n](size_t) { n.fetch_add(1); });
+  assert(n.load() == 0);
+  parallel_for(5, 6, [&n](size_t i) { n.fetch_add(static_cast<int>(i)); });
+  assert(n.load() == 5);
+  n.store(0);
+  parallel_for(0, 100, [&n](size_t) { n.fetch_add(1); }, 1);
+  assert(n.load() == 100);
+
+  parallel_for_each(v.begin(), v.end(), [](int& x) { x = -x; });
+  assert(std::all_of(v.begin(), v.end(), [](int x) { return x < 0; }));
+}
+
+void test_transform_reduce() {
+  std::vector<long> v(1 << 20);
+  for (size_t i = 0; i < v.size(); ++i) {
+    v[i] = static_cast<long>(i);
+  }
+  std::vector<std::string> out(v.size());
+  auto end = parallel_transform(v.begin(), v.end(), out.begin(),
+                                [](long x) { return std::to_string(x); });
+  assert(end == out.end());
+  assert(out[12345] == "12345");
+
+  long n = static_cast<long>(v.size());
+  long sum = parallel_reduce(0, v.size(), 0L, [&v](size_t i) { return v[i]; },
+                             std::plus<long>());
+  assert(sum == n * (n - 1) / 2);
+  long max = parallel_reduce(
+      0, v.size(), -1L, [&v](size_t i) { return v[i]; },
+      [](long a, long b) { return std::max(a, b); });
+  assert(max == n - 1);
+  assert(parallel_reduce(3, 3, 7, [](size_t) { return 1; }, std::plus<int>()) ==
+         7);
+}
+
+void test_sort() {
+  std::mt19937 rng(42);
+  for (size_t n : {0, 1, 2, 100, 5000, 1000000}) {
+    std::vector<int> v(n);
+    for (auto& x : v) {
+      x = static_cast<int>(rng() % 1000);  // 大量重复元素
+    }
+    std::vector<int> expected = v;
+    std::sort(expected.begin(), expected.end());
+    parallel_sort(v.begin(), v.end());
+    assert(v == expected);
+  }
+  // 自定义比较、已经有序
+  std::vector<int> v(200000);
+  for (size_t i = 0; i < v.size(); ++i) {
+    v[i] = static_cast<int>(i);
+  }
+  parallel_sort(v.begin(), v.end(), std::greater<int>());
+  assert(std::is_sorted(v.begin(), v.end(), std::greater<int>()));
+}
+
+// 在协程中调用，嵌套调用
+void test_nested() {
+  auto h = task_coroutine::spawn([]() {
+    std::vector<std::vector<int>> m(64, std::vector<int>(1000));
+    parallel_for(0, m.size(), [&m](size_t i) {
+      parallel_for(0, m[i].size(),
+                   [&m, i](size_t j) { m[i][j] = static_cast<int>(i * j); });
+    });
+    return parallel_reduce(
+        0, m.size(), 0L,
+        [&m](size_t i) {
+          long s = 0;
+          for (int x : m[i]) {
+            s += x;
+          }
+          return s;
+        },
+        std::plus<long>());
+  });
+  assert(h.join() == (63L * 64 / 2) * (999L * 1000 / 2));
+}
+
+// 子协程的创建位置为调用并行算法的位置
+void test_spawn_site() {
+  std::atomic<int> children(0);
+  std::atomic<int> wrong(0);
+  int call_line = 0;
+  auto check = [&](size_t) {
+    task_coroutine::TaskMeta* task = task_coroutine::TaskGroup::current_task();
+    if (task == nullptr) {
+      return;  // 在调用线程中运行的叶子区间
+    }
+    children.fetch_add(1);
+    if (strcmp(task->spawn_file, __FILE__) != 0 ||
+        task->spawn_line != call_line) {
+      wrong.fetch_add(1);
+    }
+  };
+  call_line = __LINE__ + 1;
+  parallel_for(0, 64, check, 1);
+  assert(children.load() > 0);
+  assert(wrong.load() == 0);
+}
+
+int main() {
+  test_for();
+  test_transform_reduce();
+  test_sort();
+  test_nested();
+  test_spawn_site();
+  printf("access test\n");
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "task_coroutine/task_coroutine.h"
+#include "task_coroutine/task_registry.h"
+
+using task_coroutine::TaskInfo;
+using task_coroutine::TaskRegistry;
+using task_coroutine::TaskRunState;
+
+static task_coroutine::CoSemaphore g_sem;
+static std::atomic<void*> g_wait_site(nullptr);
+static std::atomic<int> g_parked(0);
+
+// wait_here 记录返回地址（parked_fn中调用之后的位置），然后换出等待
+__attribute__((noinline)) static void wait_here() {
+  g_wait_site.store(__builtin_return_address(0));
+  g_parked.fetch_add(1);
+  g_sem.acquire();
+}
+
+__attribute__((noinline)) static void parked_fn() {
+  wait_here();
+}
+
+// deep_fn 使用约32KB的栈后返回
+__attribute__((noinline)) static void deep_fn() {
+  volatile char buf[32 * 1024];
+  for (size_t i = 0; i < sizeof(buf); i += 64) {
+    buf[i] = 1;
+  }
+}
+
+static void wait_parked(int n) {
+  while (g_parked.load() < n) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // 登记等待者之后才换出，再等一会儿
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+void test_parked() {
+  constexpr int n = 16;
+  std::vector<task_coroutine::JoinHandle<void>> hs;
+  int spawn_line = __LINE__ + 2;
+  for (int i = 0; i < n; ++i) {
+    hs.push_back(task_coroutine::spawn([i]() {
+      if (i == 0) {
+        deep_fn();
+      }
+      parked_fn();
+    }));
+  }
+  wait_parked(n);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  std::vector<TaskInfo> infos = TaskRegistry::tasks();
+  size_t parked = 0;
+  size_t deep = 0;
+  for (const TaskInfo& info : infos) {
+    if (info.spawn_file == nullptr ||
+        strcmp(info.spawn_file, __FILE__) != 0 ||
+        info.spawn_line != spawn_line) {
+      continue;
+    }
+    ++parked;
+    assert(info.state == TaskRunState::SUSPENDED);
+    assert(info.id > 0);
+    assert(info.group >= 0 &&
+           static_cast<size_t>(info.group) <
+               task_coroutine::TaskControl::get()->task_groups_num());
+    assert(info.last_run_ns > 0);
+    assert(TaskRegistry::now_ns() - info.last_run_ns >= 20 * 1000000);
+    assert(info.stack_used > 0 && info.stack_used <= info.stack_size);
+    if (info.stack_used >= 32 * 1024) {
+      ++deep;
+    }
+    assert(!info.backtrace.empty() && info.backtrace.size() < 64);
+#ifndef __OPTIMIZE__  // 优化编译时省略帧指针，回溯只有换出点
+    assert(std::find(info.backtrace.begin(), info.backtrace.end(),
+                     g_wait_site.load()) != info.backtrace.end());
+#endif
+  }
+  assert(parked == n);
+  assert(deep >= 1);
+
+  // dump中有每个协程的状态、创建位置和回溯
+  FILE* f = tmpfile();
+  TaskRegistry::dump(f);
+  std::string text(ftell(f), '\0');
+  rewind(f);
+  assert(fread(&text[0], 1, text.size(), f) == text.size());
+  fclose(f);
+  assert(text.find("SUSPENDED") != std::string::npos);
+  assert(text.find(__FILE__ ":" + std::to_string(spawn_line)) !=
+         std::string::npos);
+  assert(text.find("    #0 ") != std::string::npos);
+
+  g_sem.release(n);
+  for (auto& h : hs) {
+    h.join();
+  }
+  // join之后不再是存活的协程
+  infos = TaskRegistry::tasks(false);
+  for (const TaskInfo& info : infos) {
+    assert(info.spawn_line != spawn_line);
+  }
+}
+
+// 运行完成但JoinHandle还没有join的协程为DONE
+void test_done() {
+  std::atomic<bool> finished(false);
+  int spawn_line = __LINE__ + 1;
+  auto h = task_coroutine::spawn([&finished]() { finished.store(true); });
+  while (!finished.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  std::vector<TaskInfo> infos = TaskRegistry::tasks();
+  size_t done = 0;
+  for (const TaskInfo& info : infos) {
+    if (info.spawn_line == spawn_line) {
+      assert(info.state == TaskRunState::DONE);
+      assert(info.backtrace.empty());
+      ++done;
+    }
+  }
+  assert(done == 1);
+  h.join();
+}
+
+// 遍历注册表的同时创建、回收协程，遍历分段释放锁，移出的协程不影响遍历
+void test_concurrent() {
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> scans(0);
+  std::thread scanner([&stop, &scans]() {
+    while (!stop.load()) {
+      for (const TaskInfo& info : TaskRegistry::tasks()) {
+        assert(info.id > 0 && info.state != TaskRunState::FREE);
+        assert(info.stack_used <= info.stack_size);
+      }
+      scans.fetch_add(1);
+    }
+  });
+  for (int round = 0; round < 20 || scans.load() < 5; ++round) {
+    std::vector<task_coroutine::JoinHandle<void>> hs;
+    for (int i = 0; i < 1000; ++i) {
+      hs.push_back(task_coroutine::spawn([]() { task_coroutine::Coroutine::yield(); }));
+    }
+    for (auto& h : hs) {
+      h.join();
+    }
+  }
+  stop.store(true);
+  scanner.join();
+}
+
+int main() {
+  test_parked();
+  test_done();
+  test_concurrent();
+  printf("access test\n");
+  return 0;
+}
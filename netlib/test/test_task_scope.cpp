@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "task_coroutine/task_scope.h"
+
+using task_coroutine::Coroutine;
+using task_coroutine::spawn;
+using task_coroutine::TaskScope;
+
+// 作用域结束时所有子协程都已完成
+void test_join_on_exit() {
+  std::atomic<int> done(0);
+  {
+    TaskScope scope;
+    for (int i = 0; i < 100; ++i) {
+      scope.spawn([&done]() {
+        Coroutine::sleep_for(std::chrono::milliseconds(1));
+        done.fetch_add(1);
+      });
+    }
+  }
+  assert(done.load() == 100);
+
+  // 在协程中使用，子协程向所属的作用域继续创建
+  auto h = spawn([]() {
+    std::atomic<int> n(0);
+    TaskScope scope;
+    for (int i = 0; i < 10; ++i) {
+      scope.spawn([&scope, &n]() {
+        n.fetch_add(1);
+        scope.spawn([&n]() { n.fetch_add(1); });
+      });
+    }
+    assert(scope.join() == 0);
+    assert(!scope.cancelled());
+    return n.load();
+  });
+  assert(h.join() == 20);
+}
+
+// 第一个失败的错误码被传递，其余子协程被取消
+void test_fail() {
+  std::atomic<int> cancelled(0);
+  TaskScope scope;
+  for (int i = 0; i < 8; ++i) {
+    scope.spawn([&cancelled]() {
+      while (!TaskScope::current_cancelled()) {
+        Coroutine::sleep_for(std::chrono::milliseconds(1));
+      }
+      cancelled.fetch_add(1);
+    });
+  }
+  scope.spawn([]() -> int {
+    Coroutine::sleep_for(std::chrono::milliseconds(5));
+    return 7;
+  });
+  scope.spawn([]() -> int { return 0; });
+  assert(scope.join() == 7);
+  assert(scope.cancelled());
+  assert(cancelled.load() == 8);
+  // 取消后不再创建
+  assert(!scope.spawn([]() {}));
+  scope.fail(9);
+  assert(scope.error() == 7);
+}
+
+// 扇出后只需要第一个结果：cancel成功的子协程写入结果
+void test_first_answer() {
+  int answer = 0;
+  std::atomic<int> winners(0);
+  TaskScope scope;
+  for (int i = 1; i <= 16; ++i) {
+    scope.spawn([&scope, &answer, &winners, i]() {
+      for (int step = 0; step < i * 10; ++step) {
+        if (TaskScope::current_cancelled()) {
+          return;
+        }
+        Coroutine::yield();
+      }
+      if (scope.cancel()) {
+        answer = i;
+        winners.fetch_add(1);
+      }
+    });
+  }
+  assert(scope.join() == 0);
+  assert(winners.load() == 1);
+  assert(answer >= 1 && answer <= 16);
+}
+
+// 外层作用域取消时，子协程中的嵌套作用域也视为取消
+void test_nested() {
+  TaskScope outer;
+  std::atomic<int> spawned(0);
+  std::atomic<int> inner_cancelled(0);
+  for (int i = 0; i < 4; ++i) {
+    outer.spawn([&spawned, &inner_cancelled]() {
+      TaskScope inner;
+      for (int j = 0; j < 4; ++j) {
+        // 外层已经取消时不再创建
+        spawned += inner.spawn([&inner_cancelled]() {
+          while (!TaskScope::current_cancelled()) {
+            Coroutine::sleep_for(std::chrono::milliseconds(1));
+          }
+          inner_cancelled.fetch_add(1);
+        });
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  assert(!outer.cancelled());
+  outer.cancel();
+  assert(outer.join() == 0);
+  assert(inner_cancelled.load() == spawned.load());
+  assert(TaskScope::current() == nullptr);  // 非工作线程
+}
+
+int main() {
+  test_join_on_exit();
+  test_fail();
+  test_first_answer();
+  test_nested();
+  printf("access test\n");
+  return 0;
+}
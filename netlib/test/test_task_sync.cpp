@@ -0,0 +1,259 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <vector>
+
+#include "task_coroutine/task_coroutine.h"
+
+using task_coroutine::Channel;
+using task_coroutine::CoCondVar;
+using task_coroutine::CoMutex;
+using task_coroutine::Coroutine;
+using task_coroutine::CoSemaphore;
+using task_coroutine::Select;
+using task_coroutine::WaitGroup;
+
+// CoMutex: 多个协程累加同一个计数，协程持锁时yield
+struct MutexArg {
+  CoMutex mu;
+  size_t cnt = 0;
+};
+
+void* mutex_fn(void* arg) {
+  MutexArg* a = static_cast<MutexArg*>(arg);
+  for (int i = 0; i < 1000; ++i) {
+    a->mu.lock();
+    size_t c = a->cnt;
+    if (i % 100 == 0) {
+      Coroutine::yield();
+    }
+    a->cnt = c + 1;
+    a->mu.unlock();
+  }
+  return nullptr;
+}
+
+void test_mutex() {
+  MutexArg a;
+  std::vector<Coroutine> cs;
+  for (int i = 0; i < 16; ++i) {
+    cs.emplace_back(mutex_fn, &a);
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  assert(a.cnt == 16 * 1000);
+}
+
+// CoCondVar: 生产者协程通知等待在主线程和协程中的消费者
+struct CondArg {
+  CoMutex mu;
+  CoCondVar cv;
+  int ready = 0;
+  std::atomic<int> woken{0};
+};
+
+void* cond_wait_fn(void* arg) {
+  CondArg* a = static_cast<CondArg*>(arg);
+  a->mu.lock();
+  a->cv.wait(a->mu, [a]() -> bool { return a->ready != 0; });
+  a->mu.unlock();
+  a->woken.fetch_add(1);
+  return nullptr;
+}
+
+void test_cond_var() {
+  CondArg a;
+  std::vector<Coroutine> cs;
+  for (int i = 0; i < 8; ++i) {
+    cs.emplace_back(cond_wait_fn, &a);
+  }
+  a.mu.lock();
+  a.ready = 1;
+  a.mu.unlock();
+  a.cv.notify_all();
+  for (auto& c : cs) {
+    c.join();
+  }
+  assert(a.woken.load() == 8);
+}
+
+// CoSemaphore: 最多2个协程同时进入
+struct SemArg {
+  CoSemaphore sem{2};
+  std::atomic<int> inside{0};
+  std::atomic<int> max_inside{0};
+};
+
+void* sem_fn(void* arg) {
+  SemArg* a = static_cast<SemArg*>(arg);
+  for (int i = 0; i < 100; ++i) {
+    a->sem.acquire();
+    int n = a->inside.fetch_add(1) + 1;
+    int m = a->max_inside.load();
+    while (n > m && !a->max_inside.compare_exchange_weak(m, n))
+      ;
+    Coroutine::yield();
+    a->inside.fetch_sub(1);
+    a->sem.release();
+  }
+  return nullptr;
+}
+
+void test_semaphore() {
+  SemArg a;
+  std::vector<Coroutine> cs;
+  for (int i = 0; i < 8; ++i) {
+    cs.emplace_back(sem_fn, &a);
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  assert(a.max_inside.load() <= 2);
+  bool acquired1 = a.sem.try_acquire();
+  bool acquired2 = a.sem.try_acquire();
+  bool acquired3 = a.sem.try_acquire();
+  assert(acquired1 && acquired2 && !acquired3);
+  (void)acquired1, (void)acquired2, (void)acquired3;
+}
+
+// WaitGroup: 主线程等待一组不join的协程
+struct WgArg {
+  WaitGroup wg;
+  std::atomic<int> cnt{0};
+};
+
+void* wg_fn(void* arg) {
+  WgArg* a = static_cast<WgArg*>(arg);
+  a->cnt.fetch_add(1);
+  a->wg.done();
+  return nullptr;
+}
+
+void test_wait_group() {
+  WgArg a;
+  a.wg.add(100);
+  for (int i = 0; i < 100; ++i) {
+    Coroutine c(wg_fn, &a);
+  }
+  a.wg.wait();
+  assert(a.cnt.load() == 100);
+}
+
+// Channel: 多个生产者、多个消费者，无缓冲和有缓冲
+struct ChanArg {
+  Channel<int>* ch;
+  std::atomic<long> sum{0};
+};
+
+void* producer_fn(void* arg) {
+  ChanArg* a = static_cast<ChanArg*>(arg);
+  for (int i = 1; i <= 1000; ++i) {
+    bool sent = a->ch->send(i);
+    assert(sent);
+    (void)sent;
+  }
+  return nullptr;
+}
+
+void* consumer_fn(void* arg) {
+  ChanArg* a = static_cast<ChanArg*>(arg);
+  int v;
+  while (a->ch->recv(v)) {
+    a->sum.fetch_add(v);
+  }
+  return nullptr;
+}
+
+void test_channel(size_t capacity) {
+  Channel<int> ch(capacity);
+  ChanArg a;
+  a.ch = &ch;
+  std::vector<Coroutine> producers, consumers;
+  for (int i = 0; i < 4; ++i) {
+    producers.emplace_back(producer_fn, &a);
+    consumers.emplace_back(consumer_fn, &a);
+  }
+  for (auto& c : producers) {
+    c.join();
+  }
+  ch.close();
+  for (auto& c : consumers) {
+    c.join();
+  }
+  assert(a.sum.load() == 4 * 500500);
+  int v;
+  bool sent = ch.send(1);
+  bool received = ch.recv(v);
+  assert(!sent && !received);
+  (void)sent, (void)received;
+}
+
+// Select: 从两个channel接收，直到都关闭
+void* select_send_fn(void* arg) {
+  Channel<int>* ch = static_cast<Channel<int>*>(arg);
+  for (int i = 0; i < 100; ++i) {
+    ch->send(1);
+  }
+  ch->close();
+  return nullptr;
+}
+
+void test_select() {
+  Channel<int> ch1, ch2(4);
+  Coroutine c1(select_send_fn, &ch1);
+  Coroutine c2(select_send_fn, &ch2);
+  int v1 = 0, v2 = 0, sum = 0, n1 = 0, n2 = 0;
+  bool ok1 = true, ok2 = true;
+  while (ok1 || ok2) {
+    Select sel;
+    int i1 = -1, i2 = -1;  // 两个channel的case下标，已经关闭的不加入
+    int n = 0;
+    if (ok1) {
+      sel.recv(ch1, &v1, &ok1);
+      i1 = n++;
+    }
+    if (ok2) {
+      sel.recv(ch2, &v2, &ok2);
+      i2 = n++;
+    }
+    int i = sel.wait();
+    if (i == i1 && ok1) {
+      sum += v1;
+      ++n1;
+    } else if (i == i2 && ok2) {
+      sum += v2;
+      ++n2;
+    } else {
+      assert(i == i1 || i == i2);  // channel关闭
+    }
+  }
+  c1.join();
+  c2.join();
+  assert(sum == 200);
+  assert(n1 == 100 && n2 == 100);
+
+  Channel<int> ch3(1);
+  Select sel;
+  int v3 = 0;
+  sel.recv(ch3, &v3);
+  int i = sel.try_wait();
+  assert(i == -1);
+  ch3.send(7);
+  i = sel.try_wait();
+  assert(i == 0 && v3 == 7);
+  (void)i;
+}
+
+int main(int argc, char** argv) {
+  test_mutex();
+  test_cond_var();
+  test_semaphore();
+  test_wait_group();
+  test_channel(0);
+  test_channel(16);
+  test_select();
+  printf("access test\n");
+  return 0;
+}
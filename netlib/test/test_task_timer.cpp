@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "task_coroutine/task_coroutine.h"
+
+using task_coroutine::CoCondVar;
+using task_coroutine::CoMutex;
+using task_coroutine::Coroutine;
+using task_coroutine::CoSemaphore;
+using task_coroutine::monotonic_ns;
+using task_coroutine::TimerNode;
+using task_coroutine::TimerWheel;
+using task_coroutine::WaitGroup;
+
+constexpr int64_t MS = 1000000;
+
+// TimerWheel: 用构造之后的虚拟时间推进，覆盖第0层、降级和超出范围的定时任务
+void test_timer_wheel() {
+  TimerWheel w;
+  int64_t base = monotonic_ns();
+  std::vector<int64_t> fired;
+  struct Arg {
+    std::vector<int64_t>* fired;
+    int64_t deadline;
+  };
+  const int64_t deadlines[] = {1 * MS,       100 * MS,       255 * MS,
+                               256 * MS,     1000 * MS,      20000 * MS,
+                               3600000 * MS, 100000000 * MS};
+  std::vector<Arg> args;
+  for (int64_t d : deadlines) {
+    args.push_back(Arg{&fired, base + d});
+  }
+  std::vector<TimerNode*> nodes;
+  for (auto& a : args) {
+    nodes.push_back(w.add(
+        a.deadline,
+        [](void* arg) -> void {
+          Arg* a = static_cast<Arg*>(arg);
+          a->fired->push_back(a->deadline);
+        },
+        &a));
+  }
+  // 取消一个，不会运行
+  TimerNode* cancelled = w.add(base + 500 * MS, [](void*) { assert(false); },
+                               nullptr);
+  assert(TimerWheel::cancel(cancelled));
+
+  int64_t now = base;
+  size_t expected = 0;
+  for (int64_t d : deadlines) {
+    // 到期之前不运行
+    assert(w.next_timeout_ns() > 0 && w.next_timeout_ns() <= base + d + MS);
+    w.advance(base + d - 2 * MS > now ? base + d - 2 * MS : now);
+    assert(fired.size() == expected);
+    now = base + d + MS;
+    w.advance(now);
+    ++expected;
+    assert(fired.size() == expected);
+    assert(fired.back() == base + d);
+  }
+  assert(w.empty());
+  assert(w.next_timeout_ns() == -1);
+  for (TimerNode* node : nodes) {
+    assert(!TimerWheel::cancel(node));  // 已经运行，只释放引用
+  }
+}
+
+// sleep_for: 大量协程同时休眠，不占用工作线程
+std::atomic<int> g_sleep_done(0);
+
+void* sleep_fn(void* arg) {
+  int64_t ms = reinterpret_cast<int64_t>(arg);
+  int64_t begin = monotonic_ns();
+  Coroutine::sleep_for(std::chrono::milliseconds(ms));
+  assert(monotonic_ns() - begin >= ms * MS);
+  g_sleep_done.fetch_add(1);
+  return nullptr;
+}
+
+void test_sleep() {
+  int64_t begin = monotonic_ns();
+  std::vector<Coroutine> cs;
+  for (int64_t i = 0; i < 1000; ++i) {
+    cs.emplace_back(sleep_fn, reinterpret_cast<void*>(10 + i % 50));
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  assert(g_sleep_done.load() == 1000);
+  int64_t cost = monotonic_ns() - begin;
+  printf("test_sleep: 1000 coroutines, cost %ld ms\n", cost / MS);
+  assert(cost < 10000 * MS);
+
+  // 非工作线程中阻塞当前线程
+  begin = monotonic_ns();
+  Coroutine::sleep_until(std::chrono::steady_clock::now() +
+                         std::chrono::milliseconds(20));
+  assert(monotonic_ns() - begin >= 20 * MS);
+}
+
+// join_for: 超时后可以再次join
+void* long_fn(void*) {
+  Coroutine::sleep_for(std::chrono::milliseconds(100));
+  return nullptr;
+}
+
+void* join_for_fn(void*) {
+  Coroutine c(long_fn, nullptr);
+  assert(!c.join_for(std::chrono::milliseconds(10)));
+  assert(c.join_for(std::chrono::seconds(10)));
+  return nullptr;
+}
+
+void test_join_for() {
+  Coroutine c(long_fn, nullptr);
+  assert(!c.join_for(std::chrono::milliseconds(10)));
+  c.join();
+
+  Coroutine c2(join_for_fn, nullptr);
+  c2.join();
+}
+
+// 同步原语的超时等待
+struct TimedArg {
+  CoMutex mu;
+  CoCondVar cv;
+  CoSemaphore sem;
+  WaitGroup wg{1};
+  bool ready = false;
+};
+
+void* timed_fn(void* arg) {
+  TimedArg* a = static_cast<TimedArg*>(arg);
+  // 超时
+  assert(!a->sem.try_acquire_for(std::chrono::milliseconds(5)));
+  assert(!a->wg.wait_for(std::chrono::milliseconds(5)));
+  a->mu.lock();
+  assert(!a->cv.wait_for(a->mu, std::chrono::milliseconds(5)));
+  a->mu.unlock();
+  // 在超时之前被唤醒
+  assert(a->sem.try_acquire_for(std::chrono::seconds(10)));
+  assert(a->wg.wait_for(std::chrono::seconds(10)));
+  a->mu.lock();
+  while (!a->ready) {
+    assert(a->cv.wait_for(a->mu, std::chrono::seconds(10)));
+  }
+  a->mu.unlock();
+  return nullptr;
+}
+
+void test_timed_wait() {
+  TimedArg a;
+  Coroutine c(timed_fn, &a);
+  Coroutine::sleep_for(std::chrono::milliseconds(50));
+  a.sem.release();
+  a.wg.done();
+  a.mu.lock();
+  a.ready = true;
+  a.cv.notify_all();
+  a.mu.unlock();
+  c.join();
+
+  // 非工作线程中超时
+  CoMutex mu;
+  mu.lock();
+  assert(!mu.try_lock_for(std::chrono::milliseconds(5)));
+  mu.unlock();
+  assert(mu.try_lock_for(std::chrono::milliseconds(5)));
+  mu.unlock();
+}
+
+// 超时与唤醒竞争：每个等待者恰好获得一个计数或超时
+struct RaceArg {
+  CoSemaphore sem;
+  std::atomic<int> acquired{0};
+};
+
+void* race_fn(void* arg) {
+  RaceArg* a = static_cast<RaceArg*>(arg);
+  for (int i = 0; i < 100; ++i) {
+    if (a->sem.try_acquire_for(std::chrono::milliseconds(1))) {
+      a->acquired.fetch_add(1);
+    }
+  }
+  return nullptr;
+}
+
+void test_timeout_race() {
+  RaceArg a;
+  std::vector<Coroutine> cs;
+  for (int i = 0; i < 16; ++i) {
+    cs.emplace_back(race_fn, &a);
+  }
+  int released = 0;
+  for (int i = 0; i < 200; ++i) {
+    a.sem.release();
+    ++released;
+    if (i % 10 == 0) {
+      Coroutine::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  for (auto& c : cs) {
+    c.join();
+  }
+  int remained = 0;
+  while (a.sem.try_acquire()) {
+    ++remained;
+  }
+  assert(a.acquired.load() + remained == released);
+}
+
+int main() {
+  test_timer_wheel();
+  test_sleep();
+  test_join_for();
+  test_timed_wait();
+  test_timeout_race();
+  printf("access test\n");
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "./task_coroutine/task_work_stealing_queue.hpp"
+
+// owner端后进先出，thief端先进先出
+void test01() {
+  task_coroutine::WorkStealingQueue<int> q(4);
+  assert(q.capacity() == 4);
+  for (int i = 0; i < 4; ++i) {
+    assert(q.push(i));
+  }
+  assert(q.push(4) == false);
+  int ret = -1;
+  assert(q.pop(ret) && ret == 3);
+  assert(q.steal(ret) && ret == 0);
+  assert(q.pop(ret) && ret == 2);
+  assert(q.pop(ret) && ret == 1);
+  assert(q.pop(ret) == false);
+  assert(q.steal(ret) == false);
+}
+
+// owner push/pop的同时多个thief steal，每个元素恰好被取出一次
+void test02() {
+  constexpr int N = 1000000;
+  task_coroutine::WorkStealingQueue<int> q(1024);
+  std::vector<std::atomic<int>> seen(N);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < 3; ++i) {
+    thieves.emplace_back([&]() -> void {
+      int v;
+      while (!done.load(std::memory_order_acquire)) {
+        if (q.steal(v)) {
+          seen[v].fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  int v;
+  for (int i = 0; i < N; ++i) {
+    while (!q.push(i)) {
+      if (q.pop(v)) {
+        seen[v].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (i % 3 == 0 && q.pop(v)) {
+      seen[v].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  while (q.pop(v)) {
+    seen[v].fetch_add(1, std::memory_order_relaxed);
+  }
+  done.store(true, std::memory_order_release);
+  for (auto& t : thieves) {
+    t.join();
+  }
+  for (int i = 0; i < N; ++i) {
+    assert(seen[i].load() == 1);
+  }
+}
+
+int main(int argc, char** argv) {
+  test01();
+  test02();
+  printf("access test\n");
+  return 0;
+}
@@ -4,6 +4,8 @@
 #include <mutex>
 #include <vector>
 
+#include "task_hooks.h"
+
 namespace utils {
 
 template <typename T, typename Mutex = std::mutex>
@@ -28,8 +30,13 @@ class BlockedQueue {
 
   void push(T&& value) {
     std::unique_lock<Mutex> lock(mu_);
-    while (size_ == capacity_) {
-      not_fill_cond_.wait(lock);
+    if (size_ == capacity_) {
+      // blocks the worker thread when called from a coroutine, let the
+      // scheduler hand the queued coroutines to a spare thread
+      BlockingScope scope;
+      while (size_ == capacity_) {
+        not_fill_cond_.wait(lock);
+      }
     }
     queue_[rp_] = std::move(value);
     rp_ = rp_ + 1 == capacity_ ? 0 : rp_ + 1;
@@ -39,8 +46,11 @@ class BlockedQueue {
 
   T pop() {
     std::unique_lock<Mutex> lock(mu_);
-    while (size_ == 0) {
-      not_empty_cond_.wait(lock);
+    if (size_ == 0) {
+      BlockingScope scope;
+      while (size_ == 0) {
+        not_empty_cond_.wait(lock);
+      }
     }
     T ret(std::move(queue_[lp_]));
     lp_ = lp_ + 1 == capacity_ ? 0 : lp_ + 1;
@@ -5,6 +5,7 @@
 #include <cstdlib>
 
 #include "./fmt.h"
+#include "./task_hooks.h"
 
 namespace utils {
 namespace file {
@@ -12,10 +13,13 @@ namespace file {
 bool Directory::open(const char* path) {
   close();
   if (path != nullptr) {
-    if (::access(path, F_OK) != 0) {
-      return false;
-    }
-    directory_ = ::opendir(path);
+    // 文件系统调用可能阻塞，在协程中调用时卸载到offload线程池
+    directory_ = offload([path]() -> DIR* {
+      if (::access(path, F_OK) != 0) {
+        return nullptr;
+      }
+      return ::opendir(path);
+    });
   }
   return directory_ != nullptr;
 }
@@ -32,20 +36,27 @@ bool Directory::close() {
 
 bool Directory::create(const char* path) {
   close();
-  if (path == nullptr || ::access(path, F_OK) == 0) {
+  if (path == nullptr) {
     return false;
   }
-  std::string cmd = utils::fmt::sprintf("mkdir -p %s", path);
-  int status = ::system(cmd.c_str());
-  return status == 0;
+  return offload([path]() -> bool {
+    if (::access(path, F_OK) == 0) {
+      return false;
+    }
+    std::string cmd = utils::fmt::sprintf("mkdir -p %s", path);
+    int status = ::system(cmd.c_str());
+    return status == 0;
+  });
 }
 
 const std::vector<Dirent>& Directory::dirents() {
   if (exist()) {
-    struct dirent* entry = nullptr;
-    while ((entry = ::readdir(directory_)) != nullptr) {
-      dirents_.emplace_back(entry);
-    }
+    offload([this]() -> void {
+      struct dirent* entry = nullptr;
+      while ((entry = ::readdir(directory_)) != nullptr) {
+        dirents_.emplace_back(entry);
+      }
+    });
   }
   return dirents_;
 }
@@ -53,7 +64,8 @@ const std::vector<Dirent>& Directory::dirents() {
 bool File::open(const char* path) {
   close();
   if (path != nullptr) {
-    fd_ = ::open(path, O_RDWR | O_CLOEXEC, 0664);
+    fd_ = offload(
+        [path]() -> int { return ::open(path, O_RDWR | O_CLOEXEC, 0664); });
   }
   return fd_ >= 0;
 }
@@ -70,10 +82,12 @@ bool File::close() {
 bool File::create(const char* path) {
   close();
   if (path != nullptr) {
-    if (::access(path, F_OK) == 0) {
-      return false;
-    }
-    fd_ = ::open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0664);
+    fd_ = offload([path]() -> int {
+      if (::access(path, F_OK) == 0) {
+        return -1;
+      }
+      return ::open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0664);
+    });
   }
   return fd_ >= 0;
 }
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace utils {
+
+// 协程运行时的钩子
+// utils、json等基础模块需要配合协程调度（让出时间片、标记阻塞调用、卸载阻塞调用），
+// 但task_coroutine本身依赖utils，基础模块不能反过来依赖task_coroutine。
+// 这里只保存函数指针，由TaskControl::init设置为task_coroutine中的实现；
+// 未初始化TaskControl时为nullptr，下面的函数退化为什么也不做或直接调用。
+// 只有头文件，不需要链接task_coroutine，每次调用只有一次原子读和间接调用的开销
+
+// g_maybe_yield_fn TaskGroup::maybe_yield，见task_coroutine/task_yield.h
+inline std::atomic<void (*)()> g_maybe_yield_fn(nullptr);
+
+// maybe_yield 当前工作线程的should_yield标记被设置时让出当前协程
+// 在非工作线程、主函数和无栈任务中调用时什么也不做
+inline void maybe_yield() {
+  void (*fn)() = g_maybe_yield_fn.load(std::memory_order_relaxed);
+  if (fn != nullptr) {
+    fn();
+  }
+}
+
+// YieldCounter 热循环中每interval次调用一次maybe_yield，进一步降低检查的开销
+class YieldCounter {
+ public:
+  explicit YieldCounter(unsigned interval = 1024)
+      : interval_(interval), count_(0) {}
+
+  void tick() {
+    if (++count_ == interval_) {
+      count_ = 0;
+      maybe_yield();
+    }
+  }
+
+ private:
+  const unsigned interval_;
+  unsigned count_;
+};
+
+// g_enter_blocking_fn/g_exit_blocking_fn TaskGroup::enter_blocking/exit_blocking，
+// 见task_coroutine/task_blocking.h，先设置exit再设置enter
+inline std::atomic<void* (*)()> g_enter_blocking_fn(nullptr);
+inline std::atomic<void (*)(void*)> g_exit_blocking_fn(nullptr);
+
+// BlockingScope 标记当前协程在作用域内阻塞所在的工作线程，作用域内不能换出协程
+// 例：{ BlockingScope scope; cond.wait(lock); }
+class BlockingScope {
+ public:
+  BlockingScope() : exit_fn_(nullptr), arg_(nullptr) {
+    void* (*enter)() = g_enter_blocking_fn.load(std::memory_order_acquire);
+    if (enter != nullptr) {
+      arg_ = enter();
+      exit_fn_ = g_exit_blocking_fn.load(std::memory_order_relaxed);
+    }
+  }
+
+  BlockingScope(const BlockingScope&) = delete;
+  BlockingScope& operator=(const BlockingScope&) = delete;
+
+  ~BlockingScope() {
+    if (exit_fn_ != nullptr) {
+      exit_fn_(arg_);
+    }
+  }
+
+ private:
+  void (*exit_fn_)(void*);
+  void* arg_;  // enter的返回值，在非工作线程中为nullptr
+};
+
+// blocking 在BlockingScope中调用f()并返回其返回值
+template <typename F>
+decltype(auto) blocking(F&& f) {
+  BlockingScope scope;
+  return std::forward<F>(f)();
+}
+
+// g_offload_fn OffloadPool::call，见task_coroutine/task_offload.h
+inline std::atomic<void (*)(void (*)(void*), void*)> g_offload_fn(nullptr);
+
+// OffloadResult f()的返回值类型，引用类型按值返回
+template <typename F>
+using OffloadResult =
+    typename std::decay<std::invoke_result_t<typename std::decay<F>::type&>>::type;
+
+// offload 在OffloadPool的线程中运行f()并返回其返回值，f只在offload返回前被访问，可以捕获引用
+// 在非工作线程中调用时直接调用f()
+// 例：int fd = offload([path]() { return ::open(path, O_RDONLY); });
+template <typename F>
+OffloadResult<F> offload(F&& f) {
+  using R = OffloadResult<F>;
+  void (*call)(void (*)(void*), void*) =
+      g_offload_fn.load(std::memory_order_acquire);
+  if (call == nullptr) {
+    return f();
+  }
+  struct Call {
+    typename std::remove_reference<F>::type* f;
+    std::optional<typename std::conditional<std::is_void<R>::value, bool,
+                                            R>::type>
+        result;
+  } c{&f, std::nullopt};
+  call(
+      [](void* arg) -> void {
+        Call* c = static_cast<Call*>(arg);
+        if constexpr (std::is_void<R>::value) {
+          (*c->f)();
+        } else {
+          c->result.emplace((*c->f)());
+        }
+      },
+      &c);
+  if constexpr (!std::is_void<R>::value) {
+    return std::move(*c.result);
+  }
+}
+
+}  // namespace utils